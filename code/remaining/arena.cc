@@ -0,0 +1,84 @@
+#include <stdlib.h>
+
+#include "arena.hh"
+#include "error.hh"
+
+// Set by the compilation_context running on this thread.
+thread_local memory_arena *block_arena = NULL;
+
+/* Constructor. No memory is allocated until it's needed. */
+memory_arena::memory_arena()
+{
+    chunks = NULL;
+    next = NULL;
+    end = NULL;
+    bytes_allocated = 0;
+    objects_allocated = 0;
+}
+
+
+/* Destructor. Gives all chunks back to the heap in one go. */
+memory_arena::~memory_arena()
+{
+    while (chunks != NULL) {
+        chunk *c = chunks;
+        chunks = c->next;
+        free(c);
+    }
+}
+
+
+/* Link in a new chunk and make it the current one. Whatever was left of the
+   previous chunk is wasted. Requests larger than a chunk get a chunk of
+   their own. */
+void memory_arena::new_chunk(size_t size)
+{
+    // The chunk header is padded so that the data after it stays aligned.
+    size_t header = (sizeof(chunk) + ARENA_ALIGNMENT - 1) &
+                    ~(ARENA_ALIGNMENT - 1);
+    size_t chunk_size = header + (size > ARENA_CHUNK_SIZE ?
+                                  size : ARENA_CHUNK_SIZE);
+
+    // Taken with malloc, so that the phase profile counts the objects in
+    // the arena rather than its chunks.
+    chunk *c = (chunk *) malloc(chunk_size);
+    if (c == NULL) {
+        throw std::bad_alloc();
+    }
+    c->next = chunks;
+    chunks = c;
+
+    next = (char *) c + header;
+    end = (char *) c + chunk_size;
+}
+
+
+/* Remembers how much of the arena is used now. */
+void memory_arena::push_mark()
+{
+    mark m;
+    m.chunks = chunks;
+    m.next = next;
+    m.end = end;
+    marks.push_back(m);
+}
+
+
+/* Frees everything allocated since the last push_mark(): the chunks taken
+   since, and the part of the chunk that was current then. */
+void memory_arena::pop_mark()
+{
+    if (marks.empty()) {
+        fatal("memory_arena::pop_mark: No mark pushed");
+    }
+    mark m = marks.back();
+    marks.pop_back();
+
+    while (chunks != m.chunks) {
+        chunk *c = chunks;
+        chunks = c->next;
+        free(c);
+    }
+    next = m.next;
+    end = m.end;
+}
@@ -0,0 +1,108 @@
+#ifndef __ARENA_HH__
+#define __ARENA_HH__
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/*!
+ *  Size of each chunk a memory_arena gets from the heap.
+ */
+const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+/*!
+ *  All arena allocations are rounded up to a multiple of this, which is
+ *  enough alignment for any object.
+ */
+const size_t ARENA_ALIGNMENT = 16;
+
+/* A bump-pointer allocator. Memory is handed out from large chunks, in the
+   order it is requested, and can only be given back all at once: everything
+   by deleting the arena, or everything allocated since a mark was pushed by
+   popping it. Objects placed in an arena never have their destructors run,
+   so only use it for classes that don't need them.
+
+   Use placement new to construct objects in it:
+
+     sym = new (arena->allocate(sizeof(variable_symbol))) variable_symbol(p);
+*/
+class memory_arena
+{
+private:
+    // Chunks are kept in a list, newest first, so they can all be freed.
+    struct chunk {
+        chunk *next;
+    };
+
+    // The chunk currently allocated from.
+    chunk *chunks;
+
+    // The free part of the current chunk.
+    char *next;
+    char *end;
+
+    // Get a new chunk with room for at least the given number of bytes.
+    void new_chunk(size_t);
+
+    // The state of the arena when each mark was pushed, last one last.
+    struct mark {
+        chunk *chunks;
+        char *next;
+        char *end;
+    };
+    std::vector<mark> marks;
+
+    // Everything handed out so far, for the phase profile.
+    long bytes_allocated;
+    long objects_allocated;
+
+public:
+    memory_arena();
+
+    // Frees all memory handed out by the arena.
+    ~memory_arena();
+
+    // Returns size bytes of memory, suitably aligned for any object.
+    void *allocate(size_t size) {
+        size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+        if (size > (size_t) (end - next)) {
+            new_chunk(size);
+        }
+        void *p = next;
+        next += size;
+        bytes_allocated += size;
+        objects_allocated++;
+        return p;
+    }
+
+    // Remembers how much of the arena is used now.
+    void push_mark();
+
+    // Frees everything allocated since the last push_mark().
+    void pop_mark();
+
+    long get_bytes_allocated() { return bytes_allocated; }
+
+    long get_objects_allocated() { return objects_allocated; }
+};
+
+
+/* The arena the AST nodes, position information and quads of the blocks
+   being compiled on this thread are placed in, by the operator new of
+   their classes. The parser pushes a mark when it starts on a block, and
+   pops it once the block is translated to assembler. Set by the
+   compilation_context; if NULL, they are allocated on the heap, and never
+   freed. */
+extern thread_local memory_arena *block_arena;
+
+/* Allocates a block object. Its class's operator delete does nothing. */
+inline void *block_allocate(size_t size)
+{
+    if (block_arena == NULL) {
+        return ::operator new(size);
+    }
+    return block_arena->allocate(size);
+}
+
+
+#endif
@@ -1,3 +1,5 @@
+#include <iomanip>
+
 #include "ast.hh"
 
 
@@ -5,82 +7,184 @@
  *** The abstract AST classes - never used directly. ***
  *******************************************************/
 
-int ast_node::indent_level = 0;
-bool ast_node::branches[10000];
+thread_local int ast_node::indent_level = 0;
+thread_local vector<bool> ast_node::branches(10000, false);
+thread_local long ast_node::node_counts[NR_AST_NODE_TYPES];
+
+/* The nodes are small and there are many of them, so they hold their
+   positions themselves and ast_expression::type is narrow. The leaves fit
+   in half a cache line on 64-bit machines; -M prints all the sizes. */
+static_assert(sizeof(ast_id) <= 32, "ast_id should fit in 32 bytes");
+static_assert(sizeof(ast_integer) <= 32, "ast_integer should fit in 32 bytes");
+static_assert(sizeof(ast_real) <= 32, "ast_real should fit in 32 bytes");
 
 /* The superclass ast_node. */
-ast_node::ast_node(position_information *p) :
+ast_node::ast_node(const position_information &p) :
     pos(p)
 {
     tag = AST_NODE;
+    node_counts[AST_NODE]++;
+}
+
+
+/* Each constructor sets the tag of its class, the most derived class last,
+   so a node is counted as the kind it ends up as. */
+void ast_node::set_tag(ast_node_type t)
+{
+    node_counts[tag]--;
+    node_counts[t]++;
+    tag = t;
+}
+
+
+void ast_node::reset_node_counts()
+{
+    for (int i = 0; i < NR_AST_NODE_TYPES; i++) {
+        node_counts[i] = 0;
+    }
+}
+
+
+/* Returns the name of the node class a tag is given to, and its size. The
+   abstract classes, and AST_PARAMETER, which has no class, have no name. */
+#define NODE_KIND(t, c) case t: size = sizeof(c); return #c
+
+static const char *node_kind(int tag, size_t &size)
+{
+    switch (tag) {
+        NODE_KIND(AST_EXPR_LIST, ast_expr_list);
+        NODE_KIND(AST_STMT_LIST, ast_stmt_list);
+        NODE_KIND(AST_ELSIF_LIST, ast_elsif_list);
+        NODE_KIND(AST_ID, ast_id);
+        NODE_KIND(AST_INDEXED, ast_indexed);
+        NODE_KIND(AST_ADD, ast_add);
+        NODE_KIND(AST_SUB, ast_sub);
+        NODE_KIND(AST_OR, ast_or);
+        NODE_KIND(AST_AND, ast_and);
+        NODE_KIND(AST_MULT, ast_mult);
+        NODE_KIND(AST_DIVIDE, ast_divide);
+        NODE_KIND(AST_IDIV, ast_idiv);
+        NODE_KIND(AST_MOD, ast_mod);
+        NODE_KIND(AST_EQUAL, ast_equal);
+        NODE_KIND(AST_NOTEQUAL, ast_notequal);
+        NODE_KIND(AST_LESSTHAN, ast_lessthan);
+        NODE_KIND(AST_GREATERTHAN, ast_greaterthan);
+        NODE_KIND(AST_PROCEDURECALL, ast_procedurecall);
+        NODE_KIND(AST_ASSIGN, ast_assign);
+        NODE_KIND(AST_WHILE, ast_while);
+        NODE_KIND(AST_IF, ast_if);
+        NODE_KIND(AST_RETURN, ast_return);
+        NODE_KIND(AST_FUNCTIONCALL, ast_functioncall);
+        NODE_KIND(AST_UMINUS, ast_uminus);
+        NODE_KIND(AST_NOT, ast_not);
+        NODE_KIND(AST_ELSIF, ast_elsif);
+        NODE_KIND(AST_INTEGER, ast_integer);
+        NODE_KIND(AST_REAL, ast_real);
+        NODE_KIND(AST_FUNCTIONHEAD, ast_functionhead);
+        NODE_KIND(AST_PROCEDUREHEAD, ast_procedurehead);
+        NODE_KIND(AST_CAST, ast_cast);
+    default:
+        size = 0;
+        return NULL;
+    }
+}
+
+#undef NODE_KIND
+
+
+/* Prints the -M report. The arrays of the list nodes are not included. */
+void ast_node::print_node_sizes(ostream &o)
+{
+    long nodes = 0;
+    long bytes = 0;
+
+    o << "\nAST node sizes (bytes), and the nodes made of each kind\n"
+      << left << setw(20) << "Kind" << right << setw(8) << "Size"
+      << setw(11) << "Nodes" << setw(14) << "Bytes" << '\n'
+      << string(53, '-') << '\n';
+    for (int i = 0; i < NR_AST_NODE_TYPES; i++) {
+        size_t size;
+        const char *name = node_kind(i, size);
+        if (name == NULL) {
+            continue;
+        }
+        o << left << setw(20) << name << right << setw(8) << size
+          << setw(11) << node_counts[i] << setw(14) << size * node_counts[i]
+          << '\n';
+        nodes += node_counts[i];
+        bytes += size * node_counts[i];
+    }
+    o << string(53, '-') << '\n'
+      << left << setw(28) << "Total" << right << setw(11) << nodes
+      << setw(14) << bytes << '\n';
 }
 
 
 /* The ast_statement class. */
-ast_statement::ast_statement(position_information *p) :
+ast_statement::ast_statement(const position_information &p) :
     ast_node(p)
 {
-    tag = AST_STATEMENT;
+    set_tag(AST_STATEMENT);
 }
 
 
 
 /* The ast_expression class. */
-ast_expression::ast_expression(position_information *p) :
+ast_expression::ast_expression(const position_information &p) :
     ast_node(p)
 {
-    tag = AST_EXPRESSION;
+    set_tag(AST_EXPRESSION);
     // This will be changed later, during type checking.
     // If it hasn't been, it's an error.
     type = void_type;
 }
 
-ast_expression::ast_expression(position_information *p,
+ast_expression::ast_expression(const position_information &p,
                                sym_index s) :
     ast_node(p),
     type(s)
 {
-    tag = AST_EXPRESSION;
+    set_tag(AST_EXPRESSION);
 }
 
 
 /* The ast_binaryrelation class. They all return integer values. */
-ast_binaryrelation::ast_binaryrelation(position_information *p,
+ast_binaryrelation::ast_binaryrelation(const position_information &p,
                                        ast_expression *l,
                                        ast_expression *r) :
     ast_expression(p, integer_type),
     left(l),
     right(r)
 {
-    tag = AST_BINARYRELATION;
+    set_tag(AST_BINARYRELATION);
 }
 
 
 /* The ast_binaryoperation class. The type of the node will be synthesized
    later, during type checking. See semantic.cc. */
-ast_binaryoperation::ast_binaryoperation(position_information *p,
+ast_binaryoperation::ast_binaryoperation(const position_information &p,
         ast_expression *l,
         ast_expression *r) :
     ast_expression(p),
     left(l),
     right(r)
 {
-    tag = AST_BINARYOPERATION;
+    set_tag(AST_BINARYOPERATION);
 }
 
 
 /* The ast_lvalue class. */
-ast_lvalue::ast_lvalue(position_information *p) :
+ast_lvalue::ast_lvalue(const position_information &p) :
     ast_expression(p)
 {
-    tag = AST_LVALUE;
+    set_tag(AST_LVALUE);
 }
 
-ast_lvalue::ast_lvalue(position_information *p,
+ast_lvalue::ast_lvalue(const position_information &p,
                        sym_index s) :
     ast_expression(p, s)
 {
-    tag = AST_LVALUE;
+    set_tag(AST_LVALUE);
 }
 
 
@@ -91,118 +195,100 @@ ast_lvalue::ast_lvalue(position_information *p,
  ***********************************************************/
 
 /* The ast_elsif class. */
-ast_elsif::ast_elsif(position_information *p,
+ast_elsif::ast_elsif(const position_information &p,
                      ast_expression *c,
                      ast_stmt_list *b) :
     ast_node(p),
     condition(c),
     body(b)
 {
-    tag = AST_ELSIF;
+    set_tag(AST_ELSIF);
 }
 
 
 /* The ast_expr_list class. Currently only used for parameter lists. */
-ast_expr_list::ast_expr_list(position_information *p,
-                             ast_expression *l) :
-    ast_node(p),
-    last_expr(l)
+ast_expr_list::ast_expr_list(const position_information &p,
+                             ast_expression *e) :
+    ast_node(p)
 {
-    tag = AST_EXPR_LIST;
-    preceding = NULL;
+    set_tag(AST_EXPR_LIST);
+    exprs.push_back(e);
 }
 
-ast_expr_list::ast_expr_list(position_information *p,
-                             ast_expression *l,
-                             ast_expr_list *prev) :
-    ast_node(p),
-    last_expr(l),
-    preceding(prev)
+void ast_expr_list::add(ast_expression *e)
 {
-    tag = AST_EXPR_LIST;
+    exprs.push_back(e);
 }
 
 
 /* The ast_stmt_list class. */
-ast_stmt_list::ast_stmt_list(position_information *p,
-                             ast_statement *h) :
-    ast_node(p),
-    last_stmt(h)
+ast_stmt_list::ast_stmt_list(const position_information &p,
+                             ast_statement *s) :
+    ast_node(p)
 {
-    tag = AST_STMT_LIST;
-    preceding = NULL;
+    set_tag(AST_STMT_LIST);
+    stmts.push_back(s);
 }
 
-ast_stmt_list::ast_stmt_list(position_information *p,
-                             ast_statement *h,
-                             ast_stmt_list *t) :
-    ast_node(p),
-    last_stmt(h),
-    preceding(t)
+void ast_stmt_list::add(ast_statement *s)
 {
-    tag = AST_STMT_LIST;
+    stmts.push_back(s);
 }
 
 
 /* The ast_elsif_list class. */
-ast_elsif_list::ast_elsif_list(position_information *p,
-                               ast_elsif *h) :
-    ast_node(p),
-    last_elsif(h)
+ast_elsif_list::ast_elsif_list(const position_information &p,
+                               ast_elsif *e) :
+    ast_node(p)
 {
-    tag = AST_ELSIF_LIST;
-    preceding = NULL;
+    set_tag(AST_ELSIF_LIST);
+    elsifs.push_back(e);
 }
 
-ast_elsif_list::ast_elsif_list(position_information *p,
-                               ast_elsif *h,
-                               ast_elsif_list *t) :
-    ast_node(p),
-    last_elsif(h),
-    preceding(t)
+void ast_elsif_list::add(ast_elsif *e)
 {
-    tag = AST_ELSIF_LIST;
+    elsifs.push_back(e);
 }
 
 
 /* The ast_procedurecall class. */
-ast_procedurecall::ast_procedurecall(position_information *p,
+ast_procedurecall::ast_procedurecall(const position_information &p,
                                      ast_id *i,
                                      ast_expr_list *par) :
     ast_statement(p),
     id(i),
     parameter_list(par)
 {
-    tag = AST_PROCEDURECALL;
+    set_tag(AST_PROCEDURECALL);
 }
 
 
 /* The ast_assign class. */
-ast_assign::ast_assign(position_information *p,
+ast_assign::ast_assign(const position_information &p,
                        ast_lvalue *l,
                        ast_expression *r) :
     ast_statement(p),
     lhs(l),
     rhs(r)
 {
-    tag = AST_ASSIGN;
+    set_tag(AST_ASSIGN);
 }
 
 
 /* The ast_while class. */
-ast_while::ast_while(position_information *p,
+ast_while::ast_while(const position_information &p,
                      ast_expression *c,
                      ast_stmt_list *b) :
     ast_statement(p),
     condition(c),
     body(b)
 {
-    tag = AST_WHILE;
+    set_tag(AST_WHILE);
 }
 
 
 /* The ast_if class. */
-ast_if::ast_if(position_information *p,
+ast_if::ast_if(const position_information &p,
                ast_expression *c,
                ast_stmt_list *b,
                ast_elsif_list *eil,
@@ -213,36 +299,36 @@ ast_if::ast_if(position_information *p,
     elsif_list(eil),
     else_body(eb)
 {
-    tag = AST_IF;
+    set_tag(AST_IF);
 }
 
 
 /* The ast_return class. */
-ast_return::ast_return(position_information *p) :
+ast_return::ast_return(const position_information &p) :
     ast_statement(p)
 {
-    tag = AST_RETURN;
+    set_tag(AST_RETURN);
     value = NULL;
 }
 
-ast_return::ast_return(position_information *p,
+ast_return::ast_return(const position_information &p,
                        ast_expression *v) :
     ast_statement(p),
     value(v)
 {
-    tag = AST_RETURN;
+    set_tag(AST_RETURN);
 }
 
 
 /* The ast_functioncall class. */
-ast_functioncall::ast_functioncall(position_information *p,
+ast_functioncall::ast_functioncall(const position_information &p,
                                    ast_id *i,
                                    ast_expr_list *par) :
     ast_expression(p, i->type),
     id(i),
     parameter_list(par)
 {
-    tag = AST_FUNCTIONCALL;
+    set_tag(AST_FUNCTIONCALL);
 }
 
 
@@ -250,21 +336,21 @@ ast_functioncall::ast_functioncall(position_information *p,
 /*** Unary operator nodes: ast_uminus, ast_not. */
 
 /* The ast_uminus class. */
-ast_uminus::ast_uminus(position_information *p,
+ast_uminus::ast_uminus(const position_information &p,
                        ast_expression *e) :
     ast_expression(p, e->type),
     expr(e)
 {
-    tag = AST_UMINUS;
+    set_tag(AST_UMINUS);
 }
 
 /* The ast_not class. Logical negation. */
-ast_not::ast_not(position_information *p,
+ast_not::ast_not(const position_information &p,
                  ast_expression *e) :
     ast_expression(p, integer_type),
     expr(e)
 {
-    tag = AST_NOT;
+    set_tag(AST_NOT);
 }
 
 
@@ -272,40 +358,40 @@ ast_not::ast_not(position_information *p,
 /*** Classes derived from ast_binaryrelation. ***/
 
 /* The ast_equal class. */
-ast_equal::ast_equal(position_information *p,
+ast_equal::ast_equal(const position_information &p,
                      ast_expression *l,
                      ast_expression *r) :
     ast_binaryrelation(p, l, r)
 {
-    tag = AST_BINARYRELATION;
+    set_tag(AST_EQUAL);
 }
 
 /* The ast_notequal class. */
-ast_notequal::ast_notequal(position_information *p,
+ast_notequal::ast_notequal(const position_information &p,
                            ast_expression *l,
                            ast_expression *r) :
     ast_binaryrelation(p, l, r)
 {
-    tag = AST_NOTEQUAL;
+    set_tag(AST_NOTEQUAL);
 }
 
 
 /* The ast_lessthan class. */
-ast_lessthan::ast_lessthan(position_information *p,
+ast_lessthan::ast_lessthan(const position_information &p,
                            ast_expression *l,
                            ast_expression *r) :
     ast_binaryrelation(p, l, r)
 {
-    tag = AST_LESSTHAN;
+    set_tag(AST_LESSTHAN);
 }
 
 /* The ast_greaterthan class. */
-ast_greaterthan::ast_greaterthan(position_information *p,
+ast_greaterthan::ast_greaterthan(const position_information &p,
                                  ast_expression *l,
                                  ast_expression *r) :
     ast_binaryrelation(p, l, r)
 {
-    tag = AST_GREATERTHAN;
+    set_tag(AST_GREATERTHAN);
 }
 
 
@@ -313,75 +399,75 @@ ast_greaterthan::ast_greaterthan(position_information *p,
 /*** Classes derived from ast_binaryoperation. ***/
 
 /* The ast_add class. */
-ast_add::ast_add(position_information *p,
+ast_add::ast_add(const position_information &p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_ADD;
+    set_tag(AST_ADD);
 }
 
 /* The ast_sub class. */
-ast_sub::ast_sub(position_information *p,
+ast_sub::ast_sub(const position_information &p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_SUB;
+    set_tag(AST_SUB);
 }
 
 /* The ast_or class. */
-ast_or::ast_or(position_information *p,
+ast_or::ast_or(const position_information &p,
                ast_expression *l,
                ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_OR;
+    set_tag(AST_OR);
 }
 
 /* The ast_and class. */
-ast_and::ast_and(position_information *p,
+ast_and::ast_and(const position_information &p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_AND;
+    set_tag(AST_AND);
 }
 
 /* The ast_mult class. */
-ast_mult::ast_mult(position_information *p,
+ast_mult::ast_mult(const position_information &p,
                    ast_expression *l,
                    ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_MULT;
+    set_tag(AST_MULT);
 }
 
 /* The ast_divide class. */
-ast_divide::ast_divide(position_information *p,
+ast_divide::ast_divide(const position_information &p,
                        ast_expression *l,
                        ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_DIVIDE;
+    set_tag(AST_DIVIDE);
 }
 
 /* The ast_idiv class. */
-ast_idiv::ast_idiv(position_information *p,
+ast_idiv::ast_idiv(const position_information &p,
                    ast_expression *l,
                    ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_IDIV;
+    set_tag(AST_IDIV);
 }
 
 /* The ast_mod class. */
-ast_mod::ast_mod(position_information *p,
+ast_mod::ast_mod(const position_information &p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
 {
-    tag = AST_MOD;
+    set_tag(AST_MOD);
 }
 
 
@@ -389,77 +475,168 @@ ast_mod::ast_mod(position_information *p,
 /*** Nodes that function as lvalues: ast_id and ast_indexed ***/
 
 /* The ast_id class. */
-ast_id::ast_id(position_information *p,
+ast_id::ast_id(const position_information &p,
                sym_index s) :
     ast_lvalue(p),
     sym_p(s)
 {
-    tag = AST_ID;
+    set_tag(AST_ID);
 }
 
 
 /* The ast_indexed class. */
-ast_indexed::ast_indexed(position_information *p,
+ast_indexed::ast_indexed(const position_information &p,
                          ast_id *i,
                          ast_expression *n) :
     ast_lvalue(p),
     id(i),
     index(n)
 {
-    tag = AST_INDEXED;
+    set_tag(AST_INDEXED);
 }
 
 
 /*** Nodes for representing integer/real constants, '5' or '2.5', or so. */
 
 /* The ast_integer class. */
-ast_integer::ast_integer(position_information *p,
+ast_integer::ast_integer(const position_information &p,
                          long i) :
     ast_expression(p, integer_type),
     value(i)
 {
-    tag = AST_INTEGER;
+    set_tag(AST_INTEGER);
 }
 
 
 /* The ast_real class. Note: the value is stored in ieee 64-bit format. */
-ast_real::ast_real(position_information *p,
+ast_real::ast_real(const position_information &p,
                    double r) :
     ast_expression(p, real_type),
     value(r)
 {
-    tag = AST_REAL;
+    set_tag(AST_REAL);
 }
 
 
 /* The ast_cast class. Used to convert integers to reals. Note: the value is
    stored in ieee 64-bit format. Cast nodes are always of real type. */
-ast_cast::ast_cast(position_information *p,
+ast_cast::ast_cast(const position_information &p,
                    ast_expression *n) :
     ast_expression(p, real_type),
     expr(n)
 {
-    tag = AST_CAST;
+    set_tag(AST_CAST);
 }
 
 
 /* The ast_functionhead class. */
-ast_functionhead::ast_functionhead(position_information *p,
+ast_functionhead::ast_functionhead(const position_information &p,
                                    sym_index s) :
     ast_node(p),
     sym_p(s)
 {
-    tag = AST_FUNCTIONHEAD;
+    set_tag(AST_FUNCTIONHEAD);
 }
 
 
 /* The ast_procedurehead class. */
-ast_procedurehead::ast_procedurehead(position_information *p,
+ast_procedurehead::ast_procedurehead(const position_information &p,
                                      sym_index s) :
     ast_node(p),
     sym_p(s)
 {
-    tag = AST_PROCEDUREHEAD;
+    set_tag(AST_PROCEDUREHEAD);
+}
+
+
+
+/***********************************************
+ *** WALKING THE OPERATIONS OF AN EXPRESSION ***
+ **********************************************/
+
+/* A node binary_walk::run() is in the middle of. Exactly one of op and rel
+   is set. */
+struct binary_walk_frame {
+    ast_binaryoperation *op;
+    ast_binaryrelation *rel;
+    // Whether the left operand is done, and if so, its result.
+    bool left_done;
+    sym_index left;
+};
+
+
+/* Returns the node as a binary_walk_frame, with op or rel set, if it is a
+   binary operation or relation. Returns false otherwise. */
+static bool binary_node(ast_expression *node, binary_walk_frame &f)
+{
+    f.op = NULL;
+    f.rel = NULL;
+    f.left_done = false;
+    f.left = NULL_SYM;
+    switch (node->tag) {
+    case AST_ADD:
+    case AST_SUB:
+    case AST_OR:
+    case AST_AND:
+    case AST_MULT:
+    case AST_DIVIDE:
+    case AST_IDIV:
+    case AST_MOD:
+        f.op = static_cast<ast_binaryoperation *>(node);
+        return true;
+    case AST_EQUAL:
+    case AST_NOTEQUAL:
+    case AST_LESSTHAN:
+    case AST_GREATERTHAN:
+        f.rel = static_cast<ast_binaryrelation *>(node);
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Walks the expression in post order. Goes down the left operands as far as
+   they are operations or relations, stacking the nodes on the way, then
+   back up, doing each right operand the same way before the node itself.
+   Only the operands are recursed into, by leaf(), so the stack of the
+   thread holds only as many frames as there are other kinds of nodes, such
+   as function calls or array indexes, above the deepest leaf. */
+sym_index binary_walk::run(ast_expression *root)
+{
+    vector<binary_walk_frame> stack;
+    ast_expression *next = root;
+    sym_index result;
+
+    for (;;) {
+        binary_walk_frame f;
+        while (binary_node(next, f)) {
+            stack.push_back(f);
+            next = f.op != NULL ? f.op->left : f.rel->left;
+        }
+        result = leaf(next);
+
+        // Finish the nodes whose right operand is done, until one is found
+        // whose right operand is still to do.
+        for (;;) {
+            if (stack.empty()) {
+                return result;
+            }
+            binary_walk_frame &top = stack.back();
+            if (!top.left_done) {
+                top.left_done = true;
+                top.left = result;
+                next = top.op != NULL ? top.op->right : top.rel->right;
+                break;
+            }
+            if (top.op != NULL) {
+                result = operation(top.op, top.left, result);
+            } else {
+                result = relation(top.rel, top.left, result);
+            }
+            stack.pop_back();
+        }
+    }
 }
 
 
@@ -510,6 +687,9 @@ void ast_node::indent(ostream &o)
 void ast_node::indent_more()
 {
     indent_level += 2;
+    if ((int) branches.size() <= indent_level) {
+        branches.resize(2 * indent_level, false);
+    }
 }
 
 void ast_node::indent_less()
@@ -541,39 +721,104 @@ void ast_expression::print(ostream &o)
 }
 
 
+/* The names the binary operations and relations are printed with. */
+static const char *binary_node_name(const ast_expression *node)
+{
+    switch (node->tag) {
+    case AST_ADD:
+        return "Add";
+    case AST_SUB:
+        return "Sub";
+    case AST_OR:
+        return "Or";
+    case AST_AND:
+        return "And";
+    case AST_MULT:
+        return "Mult";
+    case AST_DIVIDE:
+        return "Divide";
+    case AST_IDIV:
+        return "Idiv";
+    case AST_MOD:
+        return "Mod";
+    case AST_EQUAL:
+        return "Equal";
+    case AST_NOTEQUAL:
+        return "Not equal";
+    case AST_LESSTHAN:
+        return "Less than";
+    case AST_GREATERTHAN:
+        return "Greater than";
+    default:
+        fatal("binary_node_name: Not a binary operation or relation");
+        return NULL;
+    }
+}
+
+
+/* Prints a binary operation or relation, and those below it, as the
+   recursive print methods would. Like binary_walk::run(), it keeps the
+   nodes it is in the middle of on a stack of its own, since an expression
+   can be as deep as it is long. Other kinds of operands are printed by
+   their own print methods. The root is printed with the given name. */
+void ast_node::print_binary(ostream &o, ast_expression *root, string name)
+{
+    vector<binary_walk_frame> stack;
+    ast_expression *next = root;
+
+    for (;;) {
+        binary_walk_frame f;
+        while (binary_node(next, f)) {
+            o << (next == root ? name : string(binary_node_name(next)))
+              << " (left, right) [" << short_symbols
+              << sym_tab->get_symbol(next->type) << long_symbols << "]\n";
+            begin_child(o);
+            stack.push_back(f);
+            next = f.op != NULL ? f.op->left : f.rel->left;
+        }
+        o << next;
+
+        // Close the nodes whose right operand is printed, until one is
+        // found whose right operand is still to print.
+        for (;;) {
+            if (stack.empty()) {
+                return;
+            }
+            binary_walk_frame &top = stack.back();
+            if (!top.left_done) {
+                top.left_done = true;
+                o << endl;
+                end_child(o);
+                last_child(o);
+                next = top.op != NULL ? top.op->right : top.rel->right;
+                break;
+            }
+            end_child(o);
+            stack.pop_back();
+        }
+    }
+}
+
+
 void ast_binaryrelation::print(ostream &o)
 {
-    o << "Binary relation";
+    xprint(o, binary_node_name(this));
 }
 
 void ast_binaryrelation::xprint(ostream &o, string s)
 {
-    o << s << " (left, right) ["
-      << short_symbols << sym_tab->get_symbol(type) << long_symbols << "]\n";
-    begin_child(o);
-    o << left << endl;
-    end_child(o);
-    last_child(o);
-    o << right;
-    end_child(o);
+    print_binary(o, this, s);
 }
 
 
 void ast_binaryoperation::print(ostream &o)
 {
-    o << "Binary operation";
+    xprint(o, binary_node_name(this));
 }
 
 void ast_binaryoperation::xprint(ostream &o, string s)
 {
-    o << s << " (left, right) ["
-      << short_symbols << sym_tab->get_symbol(type) << long_symbols << "]\n";
-    begin_child(o);
-    o << left << endl;
-    end_child(o);
-    last_child(o);
-    o << right;
-    end_child(o);
+    print_binary(o, this, s);
 }
 
 
@@ -595,43 +840,42 @@ void ast_elsif::print(ostream &o)
 }
 
 
+/* The lists print as if each element had been added by a list node of its
+   own, with the list before it as its first child, the way the lists were
+   once built. An empty list is printed as NULL at the bottom. */
+template <class T>
+void ast_node::print_list(ostream &o, const char *title,
+                          const ast_node_array<T> &items)
+{
+    for (int i = items.size() - 1; i >= 0; i--) {
+        o << title;
+        begin_child(o);
+    }
+    o << (ast_node *)NULL << endl;
+    for (int i = 0; i < items.size(); i++) {
+        end_child(o);
+        last_child(o);
+        o << items[i];
+        end_child(o);
+        if (i < items.size() - 1) {
+            o << endl;
+        }
+    }
+}
+
 void ast_expr_list::print(ostream &o)
 {
-    o << "Expression list (preceding, last_expr)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_expr << endl;
-    end_child(o);
-    last_child(o);
-    o << last_expr;
-    // o << preceding;
-    end_child(o);
+    print_list(o, "Expression list (preceding, last_expr)\n", exprs);
 }
 
 void ast_stmt_list::print(ostream &o)
 {
-    o << "Statement list (preceding, last_stmt)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_stmt << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_stmt;
-    end_child(o);
+    print_list(o, "Statement list (preceding, last_stmt)\n", stmts);
 }
 
 void ast_elsif_list::print(ostream &o)
 {
-    o << "Elsif list (preceding, last_elsif)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_elsif << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_elsif;
-    end_child(o);
+    print_list(o, "Elsif list (preceding, last_elsif)\n", elsifs);
 }
 
 
@@ -727,68 +971,6 @@ void ast_not::print(ostream &o)
 }
 
 
-void ast_equal::print(ostream &o)
-{
-    xprint(o, "Equal");
-}
-
-void ast_notequal::print(ostream &o)
-{
-    xprint(o, "Not equal");
-}
-
-void ast_lessthan::print(ostream &o)
-{
-    xprint(o, "Less than");
-}
-
-void ast_greaterthan::print(ostream &o)
-{
-    xprint(o, "Greater than");
-}
-
-
-void ast_add::print(ostream &o)
-{
-    xprint(o, "Add");
-}
-
-void ast_sub::print(ostream &o)
-{
-    xprint(o, "Sub");
-}
-
-void ast_or::print(ostream &o)
-{
-    xprint(o, "Or");
-}
-
-void ast_and::print(ostream &o)
-{
-    xprint(o, "And");
-}
-
-void ast_mult::print(ostream &o)
-{
-    xprint(o, "Mult");
-}
-
-void ast_divide::print(ostream &o)
-{
-    xprint(o, "Divide");
-}
-
-void ast_idiv::print(ostream &o)
-{
-    xprint(o, "Idiv");
-}
-
-void ast_mod::print(ostream &o)
-{
-    xprint(o, "Mod");
-}
-
-
 void ast_id::print(ostream &o)
 {
     o << "Id (" << short_symbols << sym_tab->get_symbol(sym_p)
@@ -126,7 +126,8 @@ enum ast_node_types {
     AST_FUNCTIONHEAD,
     AST_PROCEDUREHEAD,
     AST_PARAMETER,
-    AST_CAST
+    AST_CAST,
+    NR_AST_NODE_TYPES
 };
 typedef enum ast_node_types ast_node_type;
 
@@ -137,12 +138,14 @@ class quad_list;
 
 /* Class stubs to allow referencing the classes below before they're declared.
    See below. */
+class ast_expression;
 class ast_binaryoperation;
 class ast_stmt_list;
 class ast_id;
 class ast_integer;
 class ast_real;
 class ast_cast;
+template <class T> class ast_node_array;
 
 class quad_list;
 
@@ -159,8 +162,14 @@ class ast_node
 {
 protected:
     // Used for AST printing.
-    static int indent_level;
-    static bool branches[10000];
+    static thread_local int indent_level;
+    static thread_local vector<bool> branches;
+
+    // The nodes of each kind made on this thread. Counted by set_tag().
+    static thread_local long node_counts[NR_AST_NODE_TYPES];
+
+    // Sets the tag, in the constructors.
+    void set_tag(ast_node_type);
 
     // All these methods are concerned with printing the AST.
     void indent(ostream &);
@@ -175,13 +184,25 @@ protected:
 
     void last_child(ostream &);
 
+    // Prints a binary operation or relation without recursing, see ast.cc.
+    void print_binary(ostream &, ast_expression *, string);
+
+    // Prints one of the list nodes, see ast.cc.
+    template <class T>
+    void print_list(ostream &, const char *, const ast_node_array<T> &);
+
     virtual void print(ostream &);
 
     virtual void xprint(ostream &, string);
 
 public:
-    //! Holds line and column number for this node.
-    position_information *pos;
+    //! Nodes are placed in the block_arena, see arena.hh.
+    static void *operator new(size_t size) { return block_allocate(size); }
+    static void operator delete(void *) {}
+
+    /*! Holds line and column number for this node. Kept in the node, rather
+        than pointed to, to keep the small nodes small; see ast.cc. */
+    position_information pos;
 
     /*! Describes what kind of node this is. We need to be able to check this
         in a convenient way during AST optimization and C++ does not support
@@ -190,7 +211,14 @@ public:
     ast_node_type tag;
 
     // Constructor.
-    ast_node(position_information *);
+    ast_node(const position_information &);
+
+    //! Forgets the nodes made on this thread so far, see print_node_sizes().
+    static void reset_node_counts();
+
+    /*! Prints how many bytes a node of each kind takes, how many of them were
+        made on this thread, and how many bytes they take in all. */
+    static void print_node_sizes(ostream &);
 
     /*! Perform type checking. See semantic.cc for the method bodies.
      * Note that it's an error to call type_check in this class. It should
@@ -222,7 +250,7 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_statement(position_information *);
+    ast_statement(const position_information &);
 
     // It's an error if these methods are called. See the derived classes.
     virtual sym_index type_check();
@@ -243,13 +271,14 @@ class ast_expression : public ast_node
 protected:
     virtual void print(ostream &);
 public:
-    //! The return type of this expression.
-    sym_index type;
+    /*! The return type of this expression. A sym_index, but 32 bits are
+        plenty, and fit in what would be padding after ast_node::tag. */
+    int type;
 
     // Constructors.
-    ast_expression(position_information *);
+    ast_expression(const position_information &);
 
-    ast_expression(position_information *, sym_index);
+    ast_expression(const position_information &, sym_index);
 
     // It's an error if these methods are called. See the derived classes.
     virtual sym_index type_check();
@@ -311,16 +340,26 @@ public:
     ast_expression *right;
 
     // Constructor.
-    ast_binaryrelation(position_information *,
+    ast_binaryrelation(const position_information &,
                        ast_expression *,
                        ast_expression *);
 
-    // It's an error if this method is called. See the derived classes.
+    // These walk the relations and operations below the node, like those of
+    // ast_binaryoperation. The derived classes define the methods below.
     virtual sym_index type_check();
 
     virtual void optimize();
 
-    virtual sym_index generate_quads(quad_list &) = 0;
+    virtual sym_index generate_quads(quad_list &);
+
+    //! Type checks the node, given the types of its operands.
+    virtual sym_index type_check_node(sym_index, sym_index) = 0;
+
+    //! Optimizes the node, once its operands are optimized.
+    virtual void optimize_node() = 0;
+
+    //! Generates quads for the node, given where its operands' values are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index) = 0;
 };
 
 
@@ -341,16 +380,28 @@ public:
     ast_expression *right;
 
     // Constructor.
-    ast_binaryoperation(position_information *,
+    ast_binaryoperation(const position_information &,
                         ast_expression *,
                         ast_expression *);
 
-    // It's an error if these methods are called. See the derived classes.
+    /* An expression like ``a + b + c + ...`` is as deep as it is long, so
+       these don't recurse into the operations and relations below the node
+       but walk them with a binary_walk. The derived classes do the work for
+       each node in the methods below, once its operands are done. */
     virtual sym_index type_check();
 
     virtual void optimize();
 
-    virtual sym_index generate_quads(quad_list &) = 0;
+    virtual sym_index generate_quads(quad_list &);
+
+    //! Type checks the node, given the types of its operands.
+    virtual sym_index type_check_node(sym_index, sym_index) = 0;
+
+    //! Optimizes the node, once its operands are optimized.
+    virtual void optimize_node() = 0;
+
+    //! Generates quads for the node, given where its operands' values are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index) = 0;
 
     // Needed for safe downcasting.
     virtual ast_binaryoperation *get_ast_binaryoperation() {
@@ -361,6 +412,39 @@ public:
 
 
 
+/*! \brief Walks the binary operations and relations of an expression.
+
+  Visits them in post order, like a recursive pass would, but keeps the
+  nodes it is in the middle of on a stack of its own, so that an expression
+  can be as deep as it likes. Any other kind of expression is a leaf of the
+  walk, left to leaf(). The results of the operands are passed on to the
+  node they belong to, and run() returns the result of the root.
+ */
+class binary_walk
+{
+protected:
+    //! Called for the expressions that aren't operations or relations.
+    virtual sym_index leaf(ast_expression *) = 0;
+
+    //! Called for an operation, given the results of its operands.
+    virtual sym_index operation(ast_binaryoperation *,
+                                sym_index left,
+                                sym_index right) = 0;
+
+    //! Called for a relation, given the results of its operands.
+    virtual sym_index relation(ast_binaryrelation *,
+                               sym_index left,
+                               sym_index right) = 0;
+
+public:
+    virtual ~binary_walk() {}
+
+    //! Walks the expression, returning what was returned for it.
+    sym_index run(ast_expression *);
+};
+
+
+
 /*! The superclass for all DIESEL constructs that can be assigned a value
  * (i.e., which evaluate to a reference to a storage location).
  * The name lvalue comes from the fact that it represents expressions
@@ -372,9 +456,9 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructors.
-    ast_lvalue(position_information *);
+    ast_lvalue(const position_information &);
 
-    ast_lvalue(position_information *, sym_index);
+    ast_lvalue(const position_information &, sym_index);
 
     // It's an error if this method is called. See the derived classes.
     virtual sym_index type_check();
@@ -409,7 +493,7 @@ public:
     ast_stmt_list *body;
 
     // Constructor.
-    ast_elsif(position_information *, ast_expression *, ast_stmt_list *);
+    ast_elsif(const position_information &, ast_expression *, ast_stmt_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -425,26 +509,65 @@ public:
 
 
 
+/*! \brief A growable array of AST nodes, used by the list nodes below.
+
+  The array lives in the block_arena, like the nodes, so it goes away with
+  the rest of the block. When it grows, the old array is just left there.
+ */
+template <class T>
+class ast_node_array
+{
+private:
+    T **items;
+    int count;
+    int capacity;
+
+public:
+    ast_node_array() : items(NULL), count(0), capacity(0) {}
+
+    //! Adds a node at the end of the array.
+    void push_back(T *item)
+    {
+        if (count == capacity) {
+            capacity = capacity == 0 ? 4 : 2 * capacity;
+            T **bigger = (T **) block_allocate(capacity * sizeof(T *));
+            for (int i = 0; i < count; i++) {
+                bigger[i] = items[i];
+            }
+            items = bigger;
+        }
+        items[count++] = item;
+    }
+
+    //! The number of nodes in the array.
+    int size() const { return count; }
+
+    //! The node at index i, counting from 0.
+    T *operator[](int i) const { return items[i]; }
+
+    //! Allows range-based for loops over the nodes, in order.
+    T **begin() const { return items; }
+    T **end() const { return items + count; }
+};
+
+
+
 /*! Contains a list of expressions. Currently only used for parameter lists.
 
-   Note: The parameters will be stored in reverse order! This is due to how the
-         grammar is written, it's easiest this way. */
+   The expressions are stored in an array, in source order. */
 class ast_expr_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
 public:
-    //! Points to the last (last added) expression in the list.
-    ast_expression *last_expr;
-
-    //! Points to a list of the preceding expressions. Is ``NULL`` when empty.
-    ast_expr_list *preceding;
+    //! The expressions in the list, first to last.
+    ast_node_array<ast_expression> exprs;
 
     //! Constructor for the first element of a list.
-    ast_expr_list(position_information *, ast_expression *);
+    ast_expr_list(const position_information &, ast_expression *);
 
-    //! Constructor to add a new expression to the list.
-    ast_expr_list(position_information *, ast_expression *, ast_expr_list *);
+    //! Adds an expression at the end of the list.
+    void add(ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -480,27 +603,17 @@ Example:
 .. digraph :: lab3_ast_stmt_list
 
   s1 [label="ast_stmt_list"];
-  s2 [label="ast_stmt_list"];
-  s3 [label="ast_stmt_list"];
-  s4 [label="ast_stmt_list"];
-  s5 [label="ast_stmt_list"];
-  s6 [label="ast_stmt_list"];
   a1 [label="ast_assign"];
   a2 [label="ast_assign"];
   a3 [label="ast_assign"];
   a4 [label="ast_assign"];
   a5 [label="ast_assign"];
   a6 [label="ast_assign"];
-  s1 -> s2;
-  s2 -> s3;
-  s3 -> s4;
-  s4 -> s5;
-  s5 -> s6;
-  s6 -> a1;
-  s5 -> a2;
-  s4 -> a3;
-  s3 -> a4;
-  s2 -> a5;
+  s1 -> a1;
+  s1 -> a2;
+  s1 -> a3;
+  s1 -> a4;
+  s1 -> a5;
   s1 -> a6;
   a1 -> id1;
   a1 -> 1;
@@ -532,17 +645,14 @@ class ast_stmt_list : public ast_node
 protected:
     virtual void print(ostream &);
 public:
-    //! Points to the last (last added) statement in the list.
-    ast_statement *last_stmt;
-
-    //! Points to a list of the preceding statements. Is ``NULL`` when empty.
-    ast_stmt_list *preceding;
+    //! The statements in the list, first to last. Empty statements are NULL.
+    ast_node_array<ast_statement> stmts;
 
     //! Constructor for the first element of a list.
-    ast_stmt_list(position_information *, ast_statement *);
+    ast_stmt_list(const position_information &, ast_statement *);
 
-    //! Constructor to add a new statement to the list.
-    ast_stmt_list(position_information *, ast_statement *, ast_stmt_list *);
+    //! Adds a statement at the end of the list.
+    void add(ast_statement *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -562,17 +672,14 @@ class ast_elsif_list : public ast_node
 protected:
     virtual void print(ostream &);
 public:
-    //! Points to the last (last added) elsif clause in the list.
-    ast_elsif *last_elsif;
-
-    //! Points to a list of the preceding elsif clauses. Is ``NULL`` when empty.
-    ast_elsif_list *preceding;
+    //! The elsif clauses in the list, first to last.
+    ast_node_array<ast_elsif> elsifs;
 
     //! Constructor for the first element of a list.
-    ast_elsif_list(position_information *, ast_elsif *);
+    ast_elsif_list(const position_information &, ast_elsif *);
 
-    //! Constructor to add a new elsif clause to the list.
-    ast_elsif_list(position_information *, ast_elsif *, ast_elsif_list *);
+    //! Adds an elsif clause at the end of the list.
+    void add(ast_elsif *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -599,7 +706,7 @@ public:
     sym_index sym_p;
 
     // Constructor.
-    ast_functionhead(position_information *, sym_index);
+    ast_functionhead(const position_information &, sym_index);
 
     // Only here since we're using abstract virtual methods in ast_node.
     virtual void optimize();
@@ -628,7 +735,7 @@ public:
     sym_index sym_p;
 
     // Constructor.
-    ast_procedurehead(position_information *, sym_index);
+    ast_procedurehead(const position_information &, sym_index);
 
     // Only here since we're using abstract virtual methods in ast_node.
     virtual void optimize();
@@ -661,15 +768,13 @@ Example:
 
   ordering=out;
   l1 [label="ast_expr_list"];
-  l2 [label="ast_expr_list"];
 
   ast_procedure_call -> foo;
   ast_procedure_call -> l1;
   foo [label="ast_id\nfoo"];
-  l1 -> l2;
+  l1 -> "ast_integer\n1";
+  l1 -> ast_plus;
   l1 -> "ast_id\nc";
-  l2 -> "ast_integer\n1";
-  l2 -> ast_plus;
   ast_plus -> "ast_integer\n2";
   ast_plus -> "ast_integer\n3";
 
@@ -720,7 +825,7 @@ public:
     ast_expr_list *parameter_list;
 
     // Constructor.
-    ast_procedurecall(position_information *, ast_id *, ast_expr_list *);
+    ast_procedurecall(const position_information &, ast_id *, ast_expr_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -752,7 +857,7 @@ public:
     ast_expression *rhs;
 
     // Constructor.
-    ast_assign(position_information *, ast_lvalue *, ast_expression *);
+    ast_assign(const position_information &, ast_lvalue *, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -782,7 +887,7 @@ public:
     ast_stmt_list *body;
 
     // Constructor.
-    ast_while(position_information *, ast_expression *, ast_stmt_list *);
+    ast_while(const position_information &, ast_expression *, ast_stmt_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -921,7 +1026,7 @@ public:
     ast_stmt_list *else_body;
 
     // Constructor.
-    ast_if(position_information *,
+    ast_if(const position_information &,
            ast_expression *,
            ast_stmt_list *,
            ast_elsif_list *,
@@ -956,10 +1061,10 @@ public:
     ast_expression *value;
 
     //! Constructor for no return value.
-    ast_return(position_information *);
+    ast_return(const position_information &);
 
     //! Constructor with a return value.
-    ast_return(position_information *, ast_expression *);
+    ast_return(const position_information &, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -997,7 +1102,7 @@ public:
     ast_expr_list *parameter_list;
 
     // Constructor.
-    ast_functioncall(position_information *, ast_id *, ast_expr_list *);
+    ast_functioncall(const position_information &, ast_id *, ast_expr_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1024,7 +1129,7 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_uminus(position_information *, ast_expression *);
+    ast_uminus(const position_information &, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1047,7 +1152,7 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_not(position_information *, ast_expression *);
+    ast_not(const position_information &, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1070,7 +1175,7 @@ public:
     long value;
 
     // Constructor.
-    ast_integer(position_information *, long);
+    ast_integer(const position_information &, long);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1098,7 +1203,7 @@ public:
     double value;
 
     // Constructor.
-    ast_real(position_information *, double);
+    ast_real(const position_information &, double);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1131,7 +1236,7 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_cast(position_information *, ast_expression *);
+    ast_cast(const position_information &, ast_expression *);
 
     // AST optimization.
     virtual void optimize();
@@ -1152,80 +1257,72 @@ public:
 /*! Equality operator. ``a = b``. */
 class ast_equal : public ast_binaryrelation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_equal(position_information *, ast_expression *, ast_expression *);
+    ast_equal(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 };
 
 
 /*! Not-equal operator. ``a <> b``. */
 class ast_notequal : public ast_binaryrelation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_notequal(position_information *, ast_expression *, ast_expression *);
+    ast_notequal(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 };
 
 
 /*! Less than operator. ``a < b``. */
 class ast_lessthan : public ast_binaryrelation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_lessthan(position_information *, ast_expression *, ast_expression *);
+    ast_lessthan(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 };
 
 
 /*! Greater than operator. ``a > b``. */
 class ast_greaterthan : public ast_binaryrelation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_greaterthan(position_information *, ast_expression *, ast_expression *);
+    ast_greaterthan(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 };
 
 
@@ -1259,20 +1356,18 @@ public:
  */
 class ast_add : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_add(position_information *, ast_expression *, ast_expression *);
+    ast_add(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_add *get_ast_binaryoperation() {
@@ -1284,20 +1379,18 @@ public:
 /*! Minus node. ``a - b``. */
 class ast_sub : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_sub(position_information *, ast_expression *, ast_expression *);
+    ast_sub(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_sub *get_ast_binaryoperation() {
@@ -1309,20 +1402,18 @@ public:
 /*! Logical OR node. ``a OR b``. */
 class ast_or : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_or(position_information *, ast_expression *, ast_expression *);
+    ast_or(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_or *get_ast_binaryoperation() {
@@ -1334,20 +1425,18 @@ public:
 /*! Logical AND node. ``a AND b``. */
 class ast_and : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_and(position_information *, ast_expression *, ast_expression *);
+    ast_and(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_and *get_ast_binaryoperation() {
@@ -1359,20 +1448,18 @@ public:
 /*! Multiplication node. ``a * b``. */
 class ast_mult : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_mult(position_information *, ast_expression *, ast_expression *);
+    ast_mult(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_mult *get_ast_binaryoperation() {
@@ -1384,20 +1471,18 @@ public:
 /*! Real division node. ``a / b``, where at least one of a and b have real type. */
 class ast_divide : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_divide(position_information *, ast_expression *, ast_expression *);
+    ast_divide(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_divide *get_ast_binaryoperation() {
@@ -1409,20 +1494,18 @@ public:
 /*! Integer division node. ``a div b``, where both operands have integer type. */
 class ast_idiv : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_idiv(position_information *, ast_expression *, ast_expression *);
+    ast_idiv(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_idiv *get_ast_binaryoperation() {
@@ -1434,20 +1517,18 @@ public:
 /*! Integer mod node. ``a mod b``, where both operands have integer type. */
 class ast_mod : public ast_binaryoperation
 {
-protected:
-    virtual void print(ostream &);
 public:
     // Constructor.
-    ast_mod(position_information *, ast_expression *, ast_expression *);
+    ast_mod(const position_information &, ast_expression *, ast_expression *);
 
-    // Perform type checking.
-    virtual sym_index type_check();
+    // Type checking, given the types of the operands.
+    virtual sym_index type_check_node(sym_index, sym_index);
 
-    // AST optimization.
-    virtual void optimize();
+    // AST optimization, once the operands are optimized.
+    virtual void optimize_node();
 
-    // Quad generation.
-    virtual sym_index generate_quads(quad_list &);
+    // Quad generation, given where the values of the operands are.
+    virtual sym_index generate_quads_node(quad_list &, sym_index, sym_index);
 
     // Safe downcasts.
     virtual ast_mod *get_ast_binaryoperation() {
@@ -1468,9 +1549,9 @@ public:
     sym_index sym_p;
 
     // Constructors.
-    ast_id(position_information *);
+    ast_id(const position_information &);
 
-    ast_id(position_information *, sym_index);
+    ast_id(const position_information &, sym_index);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -1538,7 +1619,7 @@ public:
     ast_expression *index;
 
     // Constructor.
-    ast_indexed(position_information *, ast_id *, ast_expression *);
+    ast_indexed(const position_information &, ast_id *, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
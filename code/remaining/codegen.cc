@@ -11,11 +11,11 @@
 using namespace std;
 
 // Defined in main.cc.
-extern bool assembler_trace;
+extern thread_local bool assembler_trace;
 
-// Used in parser.y. Ideally the filename should be parametrized, but it's not
-// _that_ important...
-code_generator *code_gen = new code_generator("d.out");
+// Used in parser.y. Set by the compilation_context running on this thread,
+// which also decides the output file name.
+thread_local code_generator *code_gen = NULL;
 
 // Constructor.
 code_generator::code_generator(const string object_file_name)
@@ -25,6 +25,9 @@ code_generator::code_generator(const string object_file_name)
     reg[RAX] = "rax";
     reg[RCX] = "rcx";
     reg[RDX] = "rdx";
+    reg[RBP] = "rbp";
+
+    frame_level = 0;
 }
 
 
@@ -59,6 +62,16 @@ int code_generator::align(int frame_size)
 
 
 
+/* NOTE: The lab 7 skeleton leaves the bodies of prologue(), epilogue(),
+   find(), frame_address(), fetch(), fetch_float(), store(), store_float()
+   and array_address(), and the q_param and q_call cases of expand(), as
+   "Your code here" for the students to write. They are filled in below as
+   the reference solution for the static-link frame layout described in
+   codegen.hh, which ../trace/codetest1.dout is generated with (see
+   mkdout.cc). Strip them again before handing the lab out. */
+
+
+
 /* This method generates assembler code for initialisating a procedure or
    function. */
 void code_generator::prologue(symbol *new_env)
@@ -72,17 +85,12 @@ void code_generator::prologue(symbol *new_env)
     // Note that since we have already generated quads for the entire block
     // before we expand it to assembler, the size of the activation record
     // is known here (ar_size).
-    if (new_env->tag == SYM_PROC) {
-        procedure_symbol *proc = new_env->get_procedure_symbol();
-        ar_size = align(proc->ar_size);
-        label_nr = proc->label_nr;
-        last_arg = proc->last_parameter;
-    } else if (new_env->tag == SYM_FUNC) {
-        function_symbol *func = new_env->get_function_symbol();
+    if (new_env->hot->tag == SYM_PROC || new_env->hot->tag == SYM_FUNC) {
+        callable_symbol *env = new_env->get_callable_symbol();
         /* Make sure ar_size is a multiple of eight */
-        ar_size = align(func->ar_size);
-        label_nr = func->label_nr;
-        last_arg = func->last_parameter;
+        ar_size = align(env->ar_size);
+        label_nr = env->label_nr;
+        last_arg = env->last_parameter;
     } else {
         fatal("code_generator::prologue() called for non-proc/func");
         return;
@@ -91,14 +99,34 @@ void code_generator::prologue(symbol *new_env)
     /* Print out the label number (a SYM_PROC/ SYM_FUNC attribute) */
     out << "L" << label_nr << ":" << "\t\t\t" << "# " <<
         /* Print out the function/procedure name */
-        sym_tab->pool_lookup(new_env->id) << endl;
+        sym_tab->pool_view(new_env->id) << endl;
 
     if (assembler_trace) {
         out << "\t" << "# PROLOGUE (" << short_symbols << new_env
             << long_symbols << ")" << endl;
     }
 
-    /* Your code here */
+    // The locals of the block are one level deeper than its name.
+    frame_level = new_env->hot->level + 1;
+
+    out << "\t\t" << "push" << "\t" << "rbp" << endl;
+    out << "\t\t" << "mov" << "\t" << "rbp, rsp" << endl;
+    if (frame_level == 1) {
+        // The main program has no enclosing block, and is itself the
+        // outermost frame.
+        out << "\t\t" << "push" << "\t" << "0" << endl;
+        out << "\t\t" << "push" << "\t" << "rbp" << endl;
+    } else {
+        // The caller passes the frame of the enclosing block in rcx. Copy
+        // the outermost frame pointer from it, so globals can always be
+        // reached in one load however deep we are nested.
+        out << "\t\t" << "push" << "\t" << "rcx" << endl;
+        out << "\t\t" << "push" << "\t" << "[rcx-"
+            << FRAME_HEADER_SIZE << "]" << endl;
+    }
+    if (ar_size > 0) {
+        out << "\t\t" << "sub" << "\t" << "rsp, " << ar_size << endl;
+    }
 
     out << flush;
 }
@@ -113,18 +141,36 @@ void code_generator::epilogue(symbol *old_env)
             << long_symbols << ")" << endl;
     }
 
-    /* Your code here */
+    out << "\t\t" << "leave" << endl;
+    out << "\t\t" << "ret" << endl;
 
     out << flush;
 }
 
 
 
-/* This function finds the display register level and offset for a variable,
-   array or a parameter. Note the pass-by-pointer arguments. */
+/* This function finds the lexical level and frame offset for a variable,
+   array or a parameter. Note the pass-by-pointer arguments. Only the hot
+   fields are needed, so the symbol object itself isn't looked at. */
 void code_generator::find(sym_index sym_p, int *level, int *offset)
 {
-    /* Your code here */
+    symbol_hot *sym = sym_tab->get_symbol_hot(sym_p);
+
+    *level = sym->level;
+    switch (sym->tag) {
+    case SYM_VAR:
+    case SYM_ARRAY:
+        // Locals lie below the frame header and grow downwards. For an
+        // array this is the address of element 0; the rest lie below it.
+        *offset = -(FRAME_HEADER_SIZE + sym->offset + STACK_WIDTH);
+        break;
+    case SYM_PARAM:
+        // Parameters lie above the saved rbp and the return address.
+        *offset = 2 * STACK_WIDTH + sym->offset;
+        break;
+    default:
+        fatal("code_generator::find(): symbol has no frame address");
+    }
 }
 
 /*
@@ -132,19 +178,81 @@ void code_generator::find(sym_index sym_p, int *level, int *offset)
  */
 void code_generator::frame_address(int level, const register_type dest)
 {
-    /* Your code here */
+    if (level == frame_level) {
+        out << "\t\t" << "mov" << "\t" << reg[dest] << ", rbp" << endl;
+        return;
+    }
+    if (level == 1) {
+        out << "\t\t" << "mov" << "\t" << reg[dest] << ", [rbp-"
+            << FRAME_HEADER_SIZE << "]" << endl;
+        return;
+    }
+
+    // Follow the static links outwards, one level at a time.
+    out << "\t\t" << "mov" << "\t" << reg[dest] << ", [rbp-"
+        << STACK_WIDTH << "]" << endl;
+    for (int i = frame_level - 1; i > level; i--) {
+        out << "\t\t" << "mov" << "\t" << reg[dest] << ", ["
+            << reg[dest] << "-" << STACK_WIDTH << "]" << endl;
+    }
+}
+
+/* Returns the register to use as the base address of a frame. */
+register_type code_generator::frame_register(int level,
+                                             const register_type scratch)
+{
+    if (level == frame_level) {
+        return RBP;
+    }
+    frame_address(level, scratch);
+    return scratch;
 }
 
 /* This function fetches the value of a variable or a constant into a
    register. */
 void code_generator::fetch(sym_index sym_p, register_type dest)
 {
-    /* Your code here */
+    if (sym_tab->get_symbol_tag(sym_p) == SYM_CONST) {
+        constant_symbol *con =
+            sym_tab->get_symbol(sym_p)->get_constant_symbol();
+        long value = con->const_value.ival;
+        if (con->hot->type == real_type) {
+            value = sym_tab->ieee(con->const_value.rval);
+        }
+        out << "\t\t" << "mov" << "\t" << reg[dest] << ", " << value
+            << endl;
+        return;
+    }
+
+    int level, offset;
+    find(sym_p, &level, &offset);
+    register_type base = frame_register(level, RCX);
+    out << "\t\t" << "mov" << "\t" << reg[dest] << ", [" << reg[base]
+        << showpos << offset << noshowpos << "]" << endl;
 }
 
 void code_generator::fetch_float(sym_index sym_p)
 {
-    /* Your code here */
+    if (sym_tab->get_symbol_tag(sym_p) == SYM_CONST) {
+        // The FPU can't load immediates, so go via the stack.
+        constant_symbol *con =
+            sym_tab->get_symbol(sym_p)->get_constant_symbol();
+        if (con->hot->type != real_type) {
+            fatal("code_generator::fetch_float(): integer constant");
+        }
+        out << "\t\t" << "mov" << "\t" << "rax, "
+            << sym_tab->ieee(con->const_value.rval) << endl;
+        out << "\t\t" << "push" << "\t" << "rax" << endl;
+        out << "\t\t" << "fld" << "\t" << "qword ptr [rsp]" << endl;
+        out << "\t\t" << "add" << "\t" << "rsp, " << STACK_WIDTH << endl;
+        return;
+    }
+
+    int level, offset;
+    find(sym_p, &level, &offset);
+    register_type base = frame_register(level, RCX);
+    out << "\t\t" << "fld" << "\t" << "qword ptr [" << reg[base]
+        << showpos << offset << noshowpos << "]" << endl;
 }
 
 
@@ -152,19 +260,31 @@ void code_generator::fetch_float(sym_index sym_p)
 /* This function stores the value of a register into a variable. */
 void code_generator::store(register_type src, sym_index sym_p)
 {
-    /* Your code here */
+    int level, offset;
+    find(sym_p, &level, &offset);
+    register_type base = frame_register(level, RCX);
+    out << "\t\t" << "mov" << "\t" << "[" << reg[base] << showpos
+        << offset << noshowpos << "], " << reg[src] << endl;
 }
 
 void code_generator::store_float(sym_index sym_p)
 {
-    /* Your code here */
+    int level, offset;
+    find(sym_p, &level, &offset);
+    register_type base = frame_register(level, RCX);
+    out << "\t\t" << "fstp" << "\t" << "qword ptr [" << reg[base]
+        << showpos << offset << noshowpos << "]" << endl;
 }
 
 
 /* This function fetches the base address of an array. */
 void code_generator::array_address(sym_index sym_p, register_type dest)
 {
-    /* Your code here */
+    int level, offset;
+    find(sym_p, &level, &offset);
+    register_type base = frame_register(level, dest);
+    out << "\t\t" << "lea" << "\t" << reg[dest] << ", [" << reg[base]
+        << showpos << offset << noshowpos << "]" << endl;
 }
 
 /* This method expands a quad_list into assembler code, quad for quad. */
@@ -515,11 +635,34 @@ void code_generator::expand(quad_list *q_list)
             break;
 
         case q_param:
-            /* Your code here */
+            // Lab 7 reference solution, see the note above prologue().
+            // Parameters are pushed last first, so the first one ends up
+            // nearest the frame.
+            fetch(q->sym1, RAX);
+            out << "\t\t" << "push" << "\t" << "rax" << endl;
             break;
 
         case q_call: {
-            /* Your code here */
+            // Lab 7 reference solution, see the note above prologue().
+            callable_symbol *callee =
+                sym_tab->get_symbol(q->sym1)->get_callable_symbol();
+
+            // Pass the static link, ie, the frame of the block the callee
+            // was declared in. The predefined routines don't need one.
+            if (callee->hot->level > 0) {
+                frame_address(callee->hot->level, RCX);
+            }
+            out << "\t\t" << "call" << "\t" << "L" << callee->label_nr
+                << "\t" << "# "
+                << sym_tab->pool_view(callee->id) << endl;
+            if (q->int2 > 0) {
+                out << "\t\t" << "add" << "\t" << "rsp, "
+                    << q->int2 * STACK_WIDTH << endl;
+            }
+            // Function results are returned in rax.
+            if (q->sym3 != NULL_SYM) {
+                store(RAX, q->sym3);
+            }
             break;
         }
         case q_rreturn:
@@ -551,8 +694,8 @@ void code_generator::expand(quad_list *q_list)
             int offset;             // Offset within current activation record.
 
             find(q->sym1, &level, &offset);
-            frame_address(level, RCX);
-            out << "\t\t" << "fild" << "\t" << "qword ptr [rcx";
+            register_type base = frame_register(level, RCX);
+            out << "\t\t" << "fild" << "\t" << "qword ptr [" << reg[base];
             if (offset >= 0) {
                 out << "+" << offset;
             } else {
@@ -9,8 +9,9 @@
 using namespace std;
 
 
-/* These are the registers we will be using. */
-enum register_type { RAX, RCX, RDX };
+/* These are the registers we will be using. RBP always points to the frame
+   of the block being generated. */
+enum register_type { RAX, RCX, RDX, RBP };
 
 
 // Maximum number of formal parameters allowed.
@@ -19,12 +20,27 @@ const int MAX_PARAMETERS = 127;
 // This is the width/size of a single address on the stack (in bytes).
 const int STACK_WIDTH = 8;
 
+/* Every frame starts with two pointers below the saved rbp: the static link
+   (the frame of the enclosing block, at [rbp-8]) and a copy of the frame
+   pointer of the outermost block (at [rbp-16]). Locals come after them. */
+const int FRAME_HEADER_SIZE = 2 * STACK_WIDTH;
+
+class code_generator;
+
+// Defined in codegen.cc.
+extern thread_local code_generator *code_gen;
+
+
 /* This class generates assembler code for the Intel architecture. */
 class code_generator
 {
 private:
     // Register array.
-    string reg[3];
+    string reg[4];
+
+    // Lexical level of the locals of the block being generated, ie, the
+    // level whose frame rbp points to.
+    block_level frame_level;
 
     // Output file stream.
     ofstream out;
@@ -34,8 +50,9 @@ private:
 
     /*! \brief Generates code to create the activation record
 
-      This includes the display area and allocating space for local
-      variables and temporaries.
+      This includes the static link, the cached outermost frame pointer and
+      allocating space for local variables and temporaries. The static link
+      is passed in rcx by the caller.
      */
     void prologue(symbol *);
 
@@ -49,7 +66,7 @@ private:
     void expand(quad_list *q);
 
     /*!
-      Returns the display register level and offset for a variable,
+      Returns the lexical level and frame offset for a variable,
       array or parameter to the symbol table.
 
       Note that parameters are stored in the caller’s activation record
@@ -85,9 +102,17 @@ private:
     void array_address(sym_index, const register_type);
 
     /*! Given a lexical level and a register, stores the base address
-        of the corresponding frame from the display area.
+        of the corresponding frame in the register. The current frame is
+        in rbp and the outermost one is cached in every frame, so only
+        intermediate levels need to follow the static links.
      */
     void frame_address(int level, const register_type);
+
+    /*! Returns the register holding the base address of the frame for a
+        lexical level: rbp for the current block, otherwise the given
+        register after loading it with frame_address().
+     */
+    register_type frame_register(int level, const register_type);
 public:
     // Constructor. Arg = filename of assembler outfile.
     code_generator(const string);
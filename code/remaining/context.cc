@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "context.hh"
+#include "symtab.hh"
+#include "semantic.hh"
+#include "optimize.hh"
+#include "codegen.hh"
+#include "profile.hh"
+
+using namespace std;
+
+// Defined in scanner.l.
+extern yyscan_t create_scanner();
+extern void destroy_scanner(yyscan_t);
+extern bool scan_mapped_file(yyscan_t, const char *);
+extern void scan_stream(yyscan_t, FILE *);
+extern void scan_string(yyscan_t, const char *, int);
+extern void define_macro(yyscan_t, const char *);
+extern void undefine_macro(yyscan_t, const char *);
+extern void add_include_directory(yyscan_t, const char *);
+
+// Defined in parser.cc.
+extern int yyparse(yyscan_t);
+
+
+/* Constructor. The compiler objects are made by compile(), on the thread
+   that uses them, but the scanner is needed for the preprocessor options
+   already. */
+compilation_context::compilation_context(const string &output) :
+    symbols(NULL),
+    checker(NULL),
+    ast_opt(NULL),
+    generator(NULL),
+    prof(NULL),
+    arena(NULL),
+    output_file(output),
+    listing(&cout),
+    diagnostics(&cerr)
+{
+    scanner = create_scanner();
+}
+
+
+/* Destructor. */
+compilation_context::~compilation_context()
+{
+    // Don't leave this thread pointing at deleted objects.
+    if (sym_tab == symbols) {
+        sym_tab = NULL;
+        type_checker = NULL;
+        optimizer = NULL;
+        code_gen = NULL;
+        profile = NULL;
+        block_arena = NULL;
+        listing_stream = &cout;
+        diagnostic_stream = &cerr;
+    }
+    delete prof;
+    delete generator;
+    delete ast_opt;
+    delete checker;
+    delete symbols;
+    delete arena;
+    destroy_scanner(scanner);
+}
+
+
+/* Points the thread local globals at the objects of this context. */
+void compilation_context::activate()
+{
+    sym_tab = symbols;
+    type_checker = checker;
+    optimizer = ast_opt;
+    code_gen = generator;
+    profile = prof;
+    block_arena = arena;
+    listing_stream = listing;
+    diagnostic_stream = diagnostics;
+}
+
+
+/* Preprocessor options, kept by the scanner. */
+void compilation_context::define_macro(const char *definition)
+{
+    ::define_macro(scanner, definition);
+}
+
+
+void compilation_context::undefine_macro(const char *name)
+{
+    ::undefine_macro(scanner, name);
+}
+
+
+void compilation_context::add_include_directory(const char *directory)
+{
+    ::add_include_directory(scanner, directory);
+}
+
+
+/* Makes the compilation record what its phases cost, see profile.hh. */
+void compilation_context::enable_profile()
+{
+    if (prof == NULL) {
+        prof = new compile_profile();
+    }
+}
+
+
+/* Returns the profile of the compilation, or NULL if it isn't profiled. */
+compile_profile *compilation_context::get_profile()
+{
+    return prof;
+}
+
+
+/* Sets the streams the compilation prints to. */
+void compilation_context::redirect(ostream *listing, ostream *diagnostics)
+{
+    this->listing = listing;
+    this->diagnostics = diagnostics;
+}
+
+
+/* Makes the compiler objects on the calling thread, and installs them. */
+void compilation_context::start()
+{
+    if (symbols != NULL) {
+        fatal("compilation_context::start: Context already used");
+    }
+
+    // Making the symbol table sets the type indexes of this thread too.
+    arena = new memory_arena();
+    symbols = new symbol_table();
+    checker = new semantic();
+    ast_opt = new ast_optimizer();
+    generator = new code_generator(output_file);
+    activate();
+    error_count = 0;
+    ast_node::reset_node_counts();
+}
+
+
+/* Parses the source the scanner has been given, and with it compiles each
+   block. A fatal error ends the compilation here, already counted and
+   reported by fatal(); whatever the blocks done so far produced is kept. */
+void compilation_context::parse()
+{
+    try {
+        // This is where all the magic is done. yyparse() resides in
+        // parser.cc, which is generated by bison from parser.y.
+        begin_phase(PHASE_PARSE);
+        yyparse(scanner);
+        end_phase();
+    } catch (fatal_error &) {
+        if (prof != NULL) {
+            prof->end_all();
+        }
+    }
+}
+
+
+/* Compiles a source file, or stdin if filename is NULL, on the calling
+   thread. Returns the number of errors. */
+int compilation_context::compile(const char *filename)
+{
+    start();
+
+    FILE *file = NULL;
+    if (filename == NULL) {
+        scan_stream(scanner, stdin);
+    } else if (!scan_mapped_file(scanner, filename)) {
+        // Not a regular file, so read it the ordinary way.
+        file = fopen(filename, "r");
+        if (file == NULL) {
+            error() << filename << ": " << strerror(errno) << endl;
+            return error_count;
+        }
+        scan_stream(scanner, file);
+    }
+
+    parse();
+
+    if (file != NULL) {
+        fclose(file);
+    }
+    return error_count;
+}
+
+
+/* Compiles the given source text on the calling thread. Quoted #include
+   files are looked for in the current directory. Returns the number of
+   errors. */
+int compilation_context::compile_source(const string &source)
+{
+    start();
+    scan_string(scanner, source.data(), source.size());
+    parse();
+    return error_count;
+}
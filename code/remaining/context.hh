@@ -0,0 +1,112 @@
+#ifndef __CONTEXT_HH__
+#define __CONTEXT_HH__
+
+#include <string>
+#include <ostream>
+
+using namespace std;
+
+// The handle of a reentrant flex scanner, as declared by flex itself.
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+class symbol_table;
+class semantic;
+class ast_optimizer;
+class code_generator;
+class compile_profile;
+class memory_arena;
+
+
+/*! \brief Everything one compilation changes.
+
+  The scanner and parser are reentrant and keep their state in the
+  scanner handle. Everything else a compilation uses belongs to the
+  context, and the rest of the compiler reaches it through thread local
+  globals:
+
+  - ``sym_tab``, the symbol table,
+  - ``type_checker``, ``optimizer`` and ``code_gen``, the passes,
+  - ``profile``, the phase timings, or NULL,
+  - ``block_arena``, which holds the AST and quads,
+  - ``listing_stream`` and ``diagnostic_stream``, where output goes.
+
+  compile() points them at the objects of the context for the thread it
+  runs on. Several contexts can thus compile at the same time, one per
+  thread.
+
+  A context compiles a single source file, or source text.
+ */
+class compilation_context
+{
+private:
+    symbol_table *symbols;
+    semantic *checker;
+    ast_optimizer *ast_opt;
+    code_generator *generator;
+    compile_profile *prof;
+
+    // Holds the AST and quads of the blocks being compiled, see arena.hh.
+    memory_arena *arena;
+
+    // The scanner, which also holds the preprocessor state.
+    yyscan_t scanner;
+
+    // Name of the assembler file to write.
+    string output_file;
+
+    // Where listings and diagnostics go, cout and cerr by default.
+    ostream *listing;
+    ostream *diagnostics;
+
+    //! Points the thread local globals at the objects of this context.
+    void activate();
+
+    //! Makes the compiler objects, and activates them.
+    void start();
+
+    //! Runs the parser, which compiles the blocks, and stops at fatal errors.
+    void parse();
+
+public:
+    //! Arg = filename of the assembler outfile.
+    compilation_context(const string &);
+
+    ~compilation_context();
+
+    //! Defines a macro, as with -Dname or -Dname=value.
+    void define_macro(const char *);
+
+    //! Removes a macro definition, as with -Uname.
+    void undefine_macro(const char *);
+
+    //! Adds a directory to search for #include files, as with -Idir.
+    void add_include_directory(const char *);
+
+    //! Makes the compilation record what its phases cost, for -T.
+    void enable_profile();
+
+    //! Returns the profile, or NULL if profiling isn't enabled.
+    compile_profile *get_profile();
+
+    /*! Makes the compilation print its listings (see ::listing()) and its
+      error messages to the given streams instead. */
+    void redirect(ostream *listing, ostream *diagnostics);
+
+    /*! \brief Compiles a source file, or stdin if the name is NULL.
+
+      Runs on the calling thread, and returns the number of errors found.
+      A fatal error (see fatal()) ends the compilation and counts as one
+      of them; the calling thread carries on. The symbol table stays
+      available through ``sym_tab`` afterwards, until the context is
+      deleted.
+     */
+    int compile(const char *);
+
+    //! Compiles source text instead of a file, like compile().
+    int compile_source(const string &);
+};
+
+#endif
@@ -1,37 +1,58 @@
 /* Some global error routines. NOTE: Solve this in a better way later. */
 
-#include <cstdlib>
-
 #include "error.hh"
 
 /* Since we are using bison, one might think that this home-made error counter
    isn't really necessary - bison provides the yynerrs variable which counts
    errors, right? - Yes, but we also want to keep track of semantic errors
    and the like, which bison can't detect. */
-int error_count = 0;
+thread_local int error_count = 0;
+
+/* Where the compilation on this thread prints. A compilation_context can
+   point them at buffers of its own, so that several compilations running
+   at once don't mix their output. */
+thread_local ostream *listing_stream = &cout;
+thread_local ostream *diagnostic_stream = &cerr;
+
+
+/* Listing outstream, for the ASTs, quad lists and symbol tables printed on
+   request. */
+ostream &listing()
+{
+    return *listing_stream;
+}
 
 
 /* General error outstream. */
 ostream &error(string header)
 {
     error_count++;
-    return cerr << header;
+    return *diagnostic_stream << header;
 }
 
 
 /* Error outstream with position information given. */
 ostream &error(position_information *pos)
 {
-    return error("Error") << " line " << pos->get_line()
-           << ", col " << pos->get_column() << ": ";
+    return error(*pos);
+}
+
+
+/* The same, for the positions held by the AST nodes. */
+ostream &error(const position_information &pos)
+{
+    return error("Error") << " line " << pos.get_line()
+           << ", col " << pos.get_column() << ": ";
 }
 
 
-/* Abort program with error message. */
+/* Abort compiling with error message. The compilation_context running on
+   this thread catches the exception, and the error counts as one of its
+   own. Outside of one, the program ends. */
 void fatal(string msg)
 {
     error() << "Fatal: " << msg << endl << flush;
-    abort();
+    throw fatal_error(msg);
 }
 
 
@@ -39,9 +60,9 @@ void fatal(string msg)
    the grammar, so it's useful to at least include the line number. Since
    the error is not one we've accounted for, we don't have access to any
    position_information. NOTE: Fix scanner.l so it catches weird syntax? */
-void yyerror(string msg)
+void yyerror(int line, string msg)
 {
-    error() << "line " << yylineno << ": " << msg << endl << flush;
+    error() << "line " << line << ": " << msg << endl << flush;
 }
 
 /* Type conflict error outstream. */
@@ -57,8 +78,15 @@ ostream &type_error(position_information *pos)
     if (pos == NULL) {
         return type_error();
     }
-    return error("Type conflict, line ") << pos->get_line()
-           << ", col " << pos->get_column()
+    return type_error(*pos);
+}
+
+
+/* The same, for the positions held by the AST nodes. */
+ostream &type_error(const position_information &pos)
+{
+    return error("Type conflict, line ") << pos.get_line()
+           << ", col " << pos.get_column()
            << ": ";
 }
 
@@ -66,7 +94,7 @@ ostream &type_error(position_information *pos)
 /* General trace print function, used for debugging. */
 ostream &debug(string header)
 {
-    return cerr << header;
+    return *diagnostic_stream << header;
 }
 
 
@@ -76,8 +104,15 @@ ostream &debug(position_information *pos)
     if (pos == NULL) {
         return debug();
     }
-    return debug("Debug") << " (line " << pos->get_line()
-           << ", col " << pos->get_column() << "): ";
+    return debug(*pos);
+}
+
+
+/* The same, for the positions held by the AST nodes. */
+ostream &debug(const position_information &pos)
+{
+    return debug("Debug") << " (line " << pos.get_line()
+           << ", col " << pos.get_column() << "): ";
 }
 
 
@@ -101,14 +136,14 @@ position_information::position_information(int l, int c)
 
 
 /* Get the line number. */
-int position_information::get_line()
+int position_information::get_line() const
 {
     return line;
 }
 
 
 /* Get the column number. */
-int position_information::get_column()
+int position_information::get_column() const
 {
     return column;
 }
@@ -4,6 +4,9 @@
 #include <iostream>
 #include <sstream>
 #include <ostream>
+#include <stdexcept>
+
+#include "arena.hh"
 
 using namespace std;
 
@@ -12,11 +15,15 @@ using namespace std;
      classes and files. Breaking the OO paradigm for the sake of convenience...
      So sue me. ***/
 
-// Defined in error.cc.
-extern int error_count;
+// Defined in error.cc. Counts the errors of the compilation running on this
+// thread.
+extern thread_local int error_count;
 
-// Defined in scanner.cc (the generated file)
-extern int yylineno;
+// Defined in error.cc. The streams listing() and the error and debug
+// routines below print to, cout and cerr unless the compilation_context on
+// this thread redirects them.
+extern thread_local ostream *listing_stream;
+extern thread_local ostream *diagnostic_stream;
 
 /* This class contains (starting) line and column of a token, and is used to
    report the positions of errors in the code. */
@@ -28,36 +35,58 @@ private:
     int column;
 
 public:
+    // Placed in the block_arena, see arena.hh.
+    static void *operator new(size_t size) { return block_allocate(size); }
+    static void operator delete(void *) {}
+
     position_information();
 
     position_information(int l, int c);
 
-    int get_line();
+    int get_line() const;
 
-    int get_column();
+    int get_column() const;
 };
 
 
 /* Various methods for printing things, with or without position info.
    They are all defined for real in error.cc. */
 
-//! Prints message, aborts compiling.
+/*! Thrown by fatal(). The compilation_context catches it, so that a fatal
+    error only ends the compilation it happened in. */
+class fatal_error : public runtime_error
+{
+public:
+    fatal_error(const string &msg) : runtime_error(msg) {}
+};
+
+//! Prints message, aborts compiling by throwing fatal_error.
 extern void fatal(string);
 
-//! This must be defined (for ``flex``), but using ``error(pos) << "foo"`` is preferable.
-extern void yyerror(string);
+/*! Used by the scanner and parser, which only know the line number, but
+    using ``error(pos) << "foo"`` is preferable. */
+extern void yyerror(int line, string);
+
+//! Where ASTs, quad lists and symbol tables are printed.
+extern ostream  &listing();
 
 extern ostream  &error(string header = "Error: ");
 
 extern ostream  &error(position_information *);
 
+extern ostream  &error(const position_information &);
+
 extern ostream  &type_error();
 
 extern ostream  &type_error(position_information *);
 
+extern ostream  &type_error(const position_information &);
+
 extern ostream  &debug(string header = "Debug: ");
 
 extern ostream  &debug(position_information *);
 
+extern ostream  &debug(const position_information &);
+
 
 #endif
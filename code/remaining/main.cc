@@ -3,26 +3,58 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
 
 #include "ast.hh"
 #include "parser.hh"
+#include "context.hh"
+#include "profile.hh"
 
 using namespace std;
 
-extern int error_count;
 extern bool yydebug;
-bool assembler_trace = false;
-bool print_ast = false;
-bool print_quads = false;
-bool typecheck = true;
-bool optimize = true;
-bool quads = true;
-bool assembler = true;
+
+// The options that control a compilation. They are thread local, so that
+// each request to the compile server can have options of its own. The
+// threads of a batch and of the server start out with those given on the
+// command line, see save_options().
+thread_local bool assembler_trace = false;
+thread_local bool print_ast = false;
+thread_local bool print_quads = false;
+thread_local bool typecheck = true;
+thread_local bool optimize = true;
+thread_local bool quads = true;
+thread_local bool assembler = true;
+
+static thread_local bool print_symtab = false;
+static thread_local bool print_histogram = false;
+static thread_local bool timing = false;
+static thread_local bool node_sizes = false;
+
+// The -I, -D and -U options, in the order given, for every compilation.
+static thread_local vector<pair<int, const char *>> preprocessor_options;
+
+// Where -J writes a Chrome trace of the phases, if anywhere.
+static const char *trace_file = NULL;
 
 void usage(char *program_name)
 {
     cerr << "Usage:\n"
-         << program_name << " [-acdfpqsty] inputfile\n"
+         << program_name << " [-acdfpqstyHMT] [-Jfile] [-Idir] [-Dname[=value]] [-Uname] "
+         << "inputfile\n"
+         << program_name << " [options] [-jN] inputfile...\n"
+         << program_name << " [options] -lsocket\n"
          << program_name << " [-h?]\n"
          << "Options:\n"
          << "  -h, -?            Shows this message.\n"
@@ -34,18 +66,543 @@ void usage(char *program_name)
          << "  -q                Print quad lists.\n"
          << "  -s                Don't generate assembler code.\n"
          << "  -t                Include trace printouts in assembler code.\n"
-         << "  -y                Print symbol table.\n";
+         << "  -y                Print symbol table.\n"
+         << "  -H                Print hash table probe length histogram.\n"
+         << "  -M                Print the size of each kind of AST node.\n"
+         << "  -T                Print the time and memory used by each phase.\n"
+         << "  -Jfile            Write the phases to file as a Chrome trace.\n"
+         << "  -Idir             Look for #include files in dir.\n"
+         << "  -Dname[=value]    Define a macro, with the value 1 by default.\n"
+         << "  -Uname            Remove a macro definition.\n"
+         << "  -jN               Compile several files on N threads. Each\n"
+         << "                    file.d is compiled to file.s, and its output\n"
+         << "                    is printed when it is done.\n"
+         << "  -lsocket          Serve compile requests on a Unix socket.\n";
     exit(1);
 }
 
 
+/* Sets one of the options that control a compilation, and says so on o.
+   Returns false for an option that isn't one of them. */
+static bool set_option(int option, const char *arg, ostream &o)
+{
+    switch (option) {
+    case 'a':
+        o << "An AST will be printed for each block.\n" << flush;
+        print_ast = true;
+        break;
+    case 'c':
+        o << "No type checking will be performed.\n" << flush;
+        typecheck = false;
+        break;
+    case 'd':
+        o << "Bison debugging turned on.\n" << flush;
+        yydebug = true;
+        break;
+    case 'f':
+        o << "No optimization will be done.\n" << flush;
+        optimize = false;
+        break;
+    case 'p':
+        o << "No quads will be generated.\n" << flush;
+        quads = false;
+        break;
+    case 'q':
+        o << "A quad list will be printed for each block.\n" << flush;
+        print_quads = true;
+        break;
+    case 's':
+        o << "No assembler code will be generated.\n" << flush;
+        assembler = false;
+        break;
+    case 't':
+        o << "Assembler code will contain quad labels.\n" << flush;
+        assembler_trace = true;
+        break;
+    case 'y':
+        o << "Symbol table will be printed after compilation.\n";
+        print_symtab = true;
+        break;
+    case 'H':
+        o << "Probe length histogram will be printed after "
+          << "compilation.\n";
+        print_histogram = true;
+        break;
+    case 'M':
+        o << "AST node sizes will be printed after compilation.\n";
+        node_sizes = true;
+        break;
+    case 'T':
+        o << "Phase timing will be printed after compilation.\n";
+        timing = true;
+        break;
+    case 'I':
+    case 'D':
+    case 'U':
+        preprocessor_options.push_back(make_pair(option, arg));
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+
+/* The values of the options that control a compilation. yydebug isn't
+   one of them, since bison makes it a single global for the process. */
+struct option_values {
+    bool assembler_trace;
+    bool print_ast;
+    bool print_quads;
+    bool typecheck;
+    bool optimize;
+    bool quads;
+    bool assembler;
+    bool print_symtab;
+    bool print_histogram;
+    bool timing;
+    bool node_sizes;
+    vector<pair<int, const char *>> preprocessor_options;
+};
+
+
+/* Returns the options that control a compilation, as set on this
+   thread. */
+static option_values save_options()
+{
+    option_values v;
+    v.assembler_trace = assembler_trace;
+    v.print_ast = print_ast;
+    v.print_quads = print_quads;
+    v.typecheck = typecheck;
+    v.optimize = optimize;
+    v.quads = quads;
+    v.assembler = assembler;
+    v.print_symtab = print_symtab;
+    v.print_histogram = print_histogram;
+    v.timing = timing;
+    v.node_sizes = node_sizes;
+    v.preprocessor_options = preprocessor_options;
+    return v;
+}
+
+
+/* Sets the options of this thread to those save_options() returned. */
+static void restore_options(const option_values &v)
+{
+    assembler_trace = v.assembler_trace;
+    print_ast = v.print_ast;
+    print_quads = v.print_quads;
+    typecheck = v.typecheck;
+    optimize = v.optimize;
+    quads = v.quads;
+    assembler = v.assembler;
+    print_symtab = v.print_symtab;
+    print_histogram = v.print_histogram;
+    timing = v.timing;
+    node_sizes = v.node_sizes;
+    preprocessor_options = v.preprocessor_options;
+}
+
+
+/* Makes a context for one compilation, with the preprocessor options. */
+static compilation_context *make_context(const string &output_file)
+{
+    compilation_context *context = new compilation_context(output_file);
+    if (timing || trace_file != NULL) {
+        context->enable_profile();
+    }
+
+    for (size_t i = 0; i < preprocessor_options.size(); i++) {
+        const char *arg = preprocessor_options[i].second;
+        switch (preprocessor_options[i].first) {
+        case 'I':
+            context->add_include_directory(arg);
+            break;
+        case 'D':
+            context->define_macro(arg);
+            break;
+        case 'U':
+            context->undefine_macro(arg);
+            break;
+        }
+    }
+    return context;
+}
+
+
+/* Prints the symbol table, the AST node sizes and the phase timing of the
+   compilation on this thread, if given the appropriate flags. */
+static void print_tables()
+{
+    if (print_symtab) {
+        sym_tab->print(2);
+        sym_tab->print(1);
+    }
+    if (print_histogram) {
+        sym_tab->print(4);
+    }
+    if (node_sizes) {
+        ast_node::print_node_sizes(listing());
+    }
+    if (timing) {
+        profile->report(listing());
+    }
+}
+
+
+/* Writes the trace events of -J to trace_file, as a Chrome trace. */
+static void write_trace(const string &events)
+{
+    ofstream out(trace_file);
+    out << "{\"traceEvents\": [\n" << events << "\n]}\n";
+    if (!out) {
+        perror(trace_file);
+    }
+}
+
+
+/* The assembler file of a source file in batch mode: file.d gives file.s,
+   next to it. */
+static string output_name(const string &source)
+{
+    size_t length = source.size();
+    if (length > 2 && source.compare(length - 2, 2, ".d") == 0) {
+        length -= 2;
+    }
+    return source.substr(0, length) + ".s";
+}
+
+
+/* The state shared by the threads of a batch compilation. Files are
+   handed out in order, and their output is printed in the same order,
+   each as soon as it and those before it are done. */
+struct batch {
+    char **files;
+    int file_count;
+
+    mutex lock;
+    int next_file;
+    int next_printed;
+    vector<string> output;
+    vector<bool> done;
+    int errors;
+    int failed_files;
+
+    // The options given on the command line, for the threads.
+    option_values options;
+
+    // The Chrome trace events of the files done, for -J.
+    string trace_events;
+};
+
+
+/* Run by each thread of a batch compilation: compiles files, each with a
+   context of its own, until there are none left. */
+static void batch_worker(batch *b)
+{
+    restore_options(b->options);
+    for (;;) {
+        int i;
+        {
+            lock_guard<mutex> guard(b->lock);
+            if (b->next_file == b->file_count) {
+                return;
+            }
+            i = b->next_file++;
+        }
+
+        // Listings and errors are kept together, as they would have been
+        // printed.
+        ostringstream output;
+        compilation_context *context = make_context(output_name(b->files[i]));
+        context->redirect(&output, &output);
+        int errors = context->compile(b->files[i]);
+        print_tables();
+        ostringstream trace;
+        if (trace_file != NULL) {
+            context->get_profile()->write_trace(trace, i + 1, b->files[i]);
+        }
+        delete context;
+
+        lock_guard<mutex> guard(b->lock);
+        if (trace_file != NULL) {
+            if (!b->trace_events.empty()) {
+                b->trace_events += ",\n";
+            }
+            b->trace_events += trace.str();
+        }
+        b->output[i] = output.str();
+        b->done[i] = true;
+        b->errors += errors;
+        if (errors > 0) {
+            b->failed_files++;
+        }
+        while (b->next_printed < b->file_count && b->done[b->next_printed]) {
+            cout << "==> " << b->files[b->next_printed] << " <==\n"
+                 << b->output[b->next_printed] << flush;
+            // Printed output isn't needed anymore.
+            string().swap(b->output[b->next_printed]);
+            b->next_printed++;
+        }
+    }
+}
+
+
+/* Compiles the files on the given number of threads. Returns the total
+   number of errors. */
+static int compile_batch(char **files, int file_count, int threads)
+{
+    batch b;
+    b.files = files;
+    b.file_count = file_count;
+    b.next_file = 0;
+    b.next_printed = 0;
+    b.output.resize(file_count);
+    b.done.resize(file_count, false);
+    b.errors = 0;
+    b.failed_files = 0;
+    b.options = save_options();
+
+    if (threads > file_count) {
+        threads = file_count;
+    }
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread(batch_worker, &b));
+    }
+    for (int i = 0; i < threads; i++) {
+        pool[i].join();
+    }
+    if (trace_file != NULL) {
+        write_trace(b.trace_events);
+    }
+
+    if (b.errors > 0) {
+        cerr << "Found " << b.errors << " errors in " << b.failed_files
+             << " of " << file_count << " files.\n";
+    }
+    return b.errors;
+}
+
+
+/*** Compile server ***/
+
+/* A client connects to the socket and sends a request:
+
+     <options, eg -a -q -y -DDEBUG>
+     file <source path>
+
+   or, with the source text in the request:
+
+     <options>
+     source
+     <the program>
+
+   and then shuts down its side for writing. The options are added to
+   those the server was started with, except for -d, which is for the whole
+   server. A path is relative to the directory of the server. The server
+   answers with
+
+     errors <count>
+     listing <bytes>
+     <the listings and error messages>
+     assembly <bytes>
+     <the assembler code>
+
+   or with a single line "error <message>" if the request is malformed,
+   and closes the connection. A fatal error in the compilation is one of
+   the errors counted, and its message is in the listing. */
+
+/* Reads everything the client sends. Returns false if that fails. */
+static bool read_request(int fd, string &request)
+{
+    char buffer[65536];
+    ssize_t n;
+
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        request.append(buffer, n);
+    }
+    return true;
+}
+
+
+/* Writes all of text to the client. Returns false if that fails. */
+static bool write_response(int fd, const string &text)
+{
+    const char *p = text.data();
+    size_t left = text.size();
+
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+
+/* Returns the contents of the assembler file of a request, and removes
+   it. */
+static string take_output(const char *filename)
+{
+    ifstream in(filename);
+    ostringstream contents;
+    contents << in.rdbuf();
+    unlink(filename);
+    return contents.str();
+}
+
+
+/* Compiles what a request asks for, with the options of this thread and
+   those of the request, and returns the response. */
+static string serve_request(const string &request)
+{
+    size_t options_end = request.find('\n');
+    if (options_end == string::npos) {
+        return "error Malformed request\n";
+    }
+    size_t what_end = request.find('\n', options_end + 1);
+    if (what_end == string::npos) {
+        what_end = request.size();
+    }
+    string what = request.substr(options_end + 1, what_end - options_end - 1);
+    bool from_file = what.compare(0, 5, "file ") == 0;
+    if (!from_file && what != "source") {
+        return "error Expected \"file <path>\" or \"source\"\n";
+    }
+
+    // The -I, -D and -U options keep pointers to their arguments, so the
+    // words have to stay put until the compilation is done.
+    vector<string> words;
+    istringstream options(request.substr(0, options_end));
+    string word;
+    while (options >> word) {
+        words.push_back(word);
+    }
+
+    ostringstream listing;
+    for (size_t i = 0; i < words.size(); i++) {
+        const string &w = words[i];
+        bool takes_argument = w.size() >= 2 && strchr("IDU", w[1]) != NULL;
+        if (w.size() < 2 || w[0] != '-' || (w.size() > 2) != takes_argument ||
+                w[1] == 'd' || !set_option(w[1], w.c_str() + 2, listing)) {
+            return "error Bad option " + w + "\n";
+        }
+    }
+
+    // The assembler code is written to a temporary file, like the diesel
+    // script does.
+    char output_file[] = "/tmp/diesel-XXXXXXXXXX.s";
+    int fd = mkstemps(output_file, 2);
+    if (fd < 0) {
+        return string("error ") + strerror(errno) + "\n";
+    }
+    close(fd);
+
+    compilation_context *context = make_context(output_file);
+    context->redirect(&listing, &listing);
+    int errors;
+    if (from_file) {
+        errors = context->compile(what.c_str() + 5);
+    } else {
+        size_t source_start = min(what_end + 1, request.size());
+        errors = context->compile_source(request.substr(source_start));
+    }
+    print_tables();
+    // Deleting the context closes the assembler file.
+    delete context;
+    string assembly = take_output(output_file);
+
+    ostringstream response;
+    response << "errors " << errors << '\n'
+             << "listing " << listing.str().size() << '\n' << listing.str()
+             << "assembly " << assembly.size() << '\n' << assembly;
+    return response.str();
+}
+
+
+/* Serves the request of one client, on a thread of its own that starts
+   out with the given options. */
+static void serve_client(int client, option_values options)
+{
+    restore_options(options);
+    string request;
+    if (read_request(client, request)) {
+        write_response(client, serve_request(request));
+    }
+    close(client);
+}
+
+
+/* Serves compile requests on a Unix socket until killed. Each request gets
+   a new compilation_context, so nothing is left from the one before, and
+   the server saves the start up of a compiler process for every file. The
+   requests are served at the same time, each on a thread of its own, so a
+   slow compilation doesn't hold up the others. */
+static void run_server(const char *path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        cerr << "Socket name too long: " << path << '\n';
+        exit(1);
+    }
+    strcpy(address.sun_path, path);
+
+    // Remove a socket left by an earlier server, but nothing else.
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 ||
+            bind(server, (sockaddr *) &address, sizeof(address)) < 0 ||
+            listen(server, SOMAXCONN) < 0) {
+        perror(path);
+        exit(1);
+    }
+    // A client that goes away mustn't take the server with it.
+    signal(SIGPIPE, SIG_IGN);
+    option_values defaults = save_options();
+    cout << "Serving compile requests on " << path << ".\n" << flush;
+
+    for (;;) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("accept");
+            exit(1);
+        }
+        thread(serve_client, client, defaults).detach();
+    }
+}
+
+
 int main(int argc, char **argv)
 {
-    char options[] = "acdfpqstyh?";
+    char options[] = "acdfpqstyHMTJ:I:D:U:j:l:h?";
     int option;
-    bool print_symtab = false;
-
-    extern  FILE *yyin;
+    // Number of threads for a batch compilation, 0 if not given.
+    int threads = 0;
+    // The socket to serve compile requests on, if any.
+    const char *server_socket = NULL;
 
     opterr = 0;
     optopt = '?';
@@ -53,78 +610,66 @@ int main(int argc, char **argv)
     // Check for options.
     while ((option = getopt(argc, argv, options)) != EOF) {
         switch (option) {
-        case 'a':
-            cout << "An AST will be printed for each block.\n" << flush;
-            print_ast = true;
-            break;
-        case 'c':
-            cout << "No type checking will be performed.\n" << flush;
-            typecheck = false;
-            break;
-        case 'd':
-            cout << "Bison debugging turned on.\n" << flush;
-            yydebug = true;
+        case 'j':
+            threads = atoi(optarg);
+            if (threads < 1) {
+                usage(argv[0]);
+            }
             break;
-        case 'f':
-            cout << "No optimization will be done.\n" << flush;
-            optimize = false;
+        case 'J':
+            trace_file = optarg;
             break;
-        case 'p':
-            cout << "No quads will be generated.\n" << flush;
-            quads = false;
-            break;
-        case 'q':
-            cout << "A quad list will be printed for each block.\n"
-                 << flush;
-            print_quads = true;
-            break;
-        case 's':
-            cout << "No assembler code will be generated.\n" << flush;
-            assembler = false;
-            break;
-        case 't':
-            cout << "Assembler code will contain quad labels.\n" << flush;
-            assembler_trace = true;
-            break;
-        case 'y':
-            cout << "Symbol table will be printed after compilation.\n";
-            print_symtab = true;
+        case 'l':
+            server_socket = optarg;
             break;
         case 'h':
         case '?':
             usage(argv[0]);
             break;
         default:
+            set_option(option, optarg, cout);
             break;
         }
     }
 
-    if (optind > argc || optind < argc - 1) {
-        usage(argv[0]);
-    } else if (optind == argc) {
-        yyin = stdin;
-    } else {
-        yyin = fopen(argv[optind], "r");
-        if (yyin == NULL) {
-            perror(argv[optind]);
-            exit(1);
+    // The compile server takes its files from the requests.
+    if (server_socket != NULL) {
+        if (optind < argc) {
+            usage(argv[0]);
+        }
+        run_server(server_socket);
+        exit(0);
+    }
+
+    // Several files, or -j, make a batch compilation. Each file gets a
+    // context and an assembler file of its own.
+    if (optind < argc - 1 || (threads > 0 && optind < argc)) {
+        if (threads == 0) {
+            threads = thread::hardware_concurrency();
         }
+        int errors = compile_batch(argv + optind, argc - optind,
+                                   threads > 0 ? threads : 1);
+        // The exit status only has eight bits.
+        exit(errors > 255 ? 255 : errors);
     }
 
-    // Start the compilation. This is where all the magic is done.
-    // This function resides in parser.cc, which is generated by bison from
-    // parser.y.
-    yyparse();
+    if (optind > argc) {
+        usage(argv[0]);
+    }
+
+    // Start the compilation, of stdin if no file was given.
+    compilation_context *context = make_context("d.out");
+    int errors = context->compile(optind == argc ? NULL : argv[optind]);
 
     // If given the appropriate flag, prints the symbol table after the input
     // has been parsed.
-    if (print_symtab) {
-        sym_tab->print(2);
-        sym_tab->print(1);
+    print_tables();
+    if (trace_file != NULL) {
+        ostringstream trace;
+        context->get_profile()->write_trace(trace, 1, optind == argc ?
+                                            "stdin" : argv[optind]);
+        write_trace(trace.str());
     }
 
-    exit(error_count);
+    exit(errors);
 }
-
-
-
@@ -0,0 +1,153 @@
+#include <iostream>
+#include "symtab.hh"
+#include "quads.hh"
+#include "codegen.hh"
+
+using namespace std;
+
+// Writes the assembler for ../testpgm/codetest1.d, the way the compiler
+// would, without needing the scanner and parser. The symbol table and the
+// quads the reference compiler builds for codetest1.d are set up by hand,
+// in the same order as the parser does it, and run through the code
+// generator. The result is what ../trace/codetest1.dout holds, so that file
+// can be regenerated when the code generator changes. Run by 'make dout'.
+
+// The flags main.cc would set. The code generator looks at some of them.
+thread_local bool typecheck = true;
+thread_local bool print_ast = false;
+thread_local bool optimize = true;
+thread_local bool quads = true;
+thread_local bool print_quads = false;
+thread_local bool assembler = true;
+thread_local bool assembler_trace = false;
+
+static position_information pos(1, 1);
+
+
+/* Installs a name in the string pool. */
+static pool_index name(const char *s)
+{
+    return sym_tab->pool_install((char *) s);
+}
+
+
+/* Appends a quad to a list. */
+static void emit(quad_list *q,
+                 quad_op_type op,
+                 long int a,
+                 long int b,
+                 long int c)
+{
+    *q += new quadruple(op, a, b, c);
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " <outfile>" << endl;
+        return 1;
+    }
+
+    sym_tab = new symbol_table(NULL);
+    code_gen = new code_generator(argv[1]);
+
+    // program main;
+    sym_index main_p = sym_tab->enter_procedure(&pos, name("MAIN"));
+    sym_tab->open_scope();
+
+    // procedure write_int(val : integer); const ...; var ...;
+    sym_index write_int = sym_tab->enter_procedure(&pos, name("WRITE_INT"));
+    sym_tab->open_scope();
+    sym_index val = sym_tab->enter_parameter(&pos, name("VAL"), integer_type);
+    sym_index ascii0 =
+        sym_tab->enter_constant(&pos, name("ASCII0"), integer_type, 48L);
+    sym_index minus =
+        sym_tab->enter_constant(&pos, name("MINUS"), integer_type, 45L);
+    sym_index c = sym_tab->enter_variable(&pos, name("C"), integer_type);
+    sym_index buf = sym_tab->enter_array(&pos, name("BUF"), integer_type, 10);
+    sym_index bufp = sym_tab->enter_variable(&pos, name("BUFP"), integer_type);
+    sym_index write = sym_tab->lookup_symbol(name("WRITE"));
+
+    // The labels and temporaries write_int's body uses, numbered as in the
+    // reference compiler's output.
+    long label[12];
+    for (int i = 5; i <= 11; i++) {
+        label[i] = sym_tab->get_next_label();
+    }
+    sym_index t[23];
+    for (int i = 1; i <= 21; i++) {
+        t[i] = sym_tab->gen_temp_var(integer_type);
+    }
+
+    quad_list *q = new quad_list(label[5]);
+    // if (val = 0) then write(ASCII0); return; end;
+    emit(q, q_iload, 0, NULL_SYM, t[1]);
+    emit(q, q_ieq, val, t[1], t[2]);
+    emit(q, q_jmpf, label[6], t[2], NULL_SYM);
+    emit(q, q_param, ascii0, NULL_SYM, NULL_SYM);
+    emit(q, q_call, write, 1, NULL_SYM);
+    emit(q, q_jmp, label[5], NULL_SYM, NULL_SYM);
+    emit(q, q_labl, label[6], NULL_SYM, NULL_SYM);
+    // if (val < 0) then write(MINUS); val := -val; end;
+    emit(q, q_iload, 0, NULL_SYM, t[3]);
+    emit(q, q_ilt, val, t[3], t[4]);
+    emit(q, q_jmpf, label[7], t[4], NULL_SYM);
+    emit(q, q_param, minus, NULL_SYM, NULL_SYM);
+    emit(q, q_call, write, 1, NULL_SYM);
+    emit(q, q_iuminus, val, NULL_SYM, t[5]);
+    emit(q, q_iassign, t[5], NULL_SYM, val);
+    emit(q, q_labl, label[7], NULL_SYM, NULL_SYM);
+    // bufp := 0;
+    emit(q, q_iload, 0, NULL_SYM, t[6]);
+    emit(q, q_iassign, t[6], NULL_SYM, bufp);
+    // while val > 0 do ... end;
+    emit(q, q_labl, label[8], NULL_SYM, NULL_SYM);
+    emit(q, q_iload, 0, NULL_SYM, t[7]);
+    emit(q, q_igt, val, t[7], t[8]);
+    emit(q, q_jmpf, label[9], t[8], NULL_SYM);
+    emit(q, q_iload, 10, NULL_SYM, t[9]);
+    emit(q, q_imod, val, t[9], t[10]);
+    emit(q, q_iassign, t[10], NULL_SYM, c);
+    emit(q, q_iplus, c, ascii0, t[11]);
+    emit(q, q_lindex, buf, bufp, t[12]);
+    emit(q, q_istore, t[11], NULL_SYM, t[12]);
+    emit(q, q_iload, 1, NULL_SYM, t[13]);
+    emit(q, q_iplus, bufp, t[13], t[14]);
+    emit(q, q_iassign, t[14], NULL_SYM, bufp);
+    emit(q, q_iload, 10, NULL_SYM, t[15]);
+    emit(q, q_idivide, val, t[15], t[16]);
+    emit(q, q_iassign, t[16], NULL_SYM, val);
+    emit(q, q_jmp, label[8], NULL_SYM, NULL_SYM);
+    emit(q, q_labl, label[9], NULL_SYM, NULL_SYM);
+    // while (bufp > 0) do bufp := bufp - 1; write(buf[bufp]); end;
+    emit(q, q_labl, label[10], NULL_SYM, NULL_SYM);
+    emit(q, q_iload, 0, NULL_SYM, t[17]);
+    emit(q, q_igt, bufp, t[17], t[18]);
+    emit(q, q_jmpf, label[11], t[18], NULL_SYM);
+    emit(q, q_iload, 1, NULL_SYM, t[19]);
+    emit(q, q_iminus, bufp, t[19], t[20]);
+    emit(q, q_iassign, t[20], NULL_SYM, bufp);
+    emit(q, q_irindex, buf, bufp, t[21]);
+    emit(q, q_param, t[21], NULL_SYM, NULL_SYM);
+    emit(q, q_call, write, 1, NULL_SYM);
+    emit(q, q_jmp, label[10], NULL_SYM, NULL_SYM);
+    emit(q, q_labl, label[11], NULL_SYM, NULL_SYM);
+    emit(q, q_labl, label[5], NULL_SYM, NULL_SYM);
+    code_gen->generate_assembler(q, sym_tab->get_symbol(write_int));
+    sym_tab->close_scope();
+
+    // begin write_int(23); end.
+    long main_label = sym_tab->get_next_label();
+    t[22] = sym_tab->gen_temp_var(integer_type);
+    q = new quad_list(main_label);
+    emit(q, q_iload, 23, NULL_SYM, t[22]);
+    emit(q, q_param, t[22], NULL_SYM, NULL_SYM);
+    emit(q, q_call, write_int, 1, NULL_SYM);
+    emit(q, q_labl, main_label, NULL_SYM, NULL_SYM);
+    code_gen->generate_assembler(q, sym_tab->get_symbol(main_p));
+    sym_tab->close_scope();
+
+    delete code_gen;
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include <iostream>
+#include "symtab.hh"
+
+using namespace std;
+
+// Writes the symbol table image holding the predefined symbols, which the
+// compiler loads on startup instead of installing them one by one. Run by
+// make, see the Makefile.
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " <image>" << endl;
+        return 1;
+    }
+
+    // Install the predefined symbols by hand, rather than loading them
+    // from an old image.
+    sym_tab = new symbol_table(NULL);
+
+    if (!sym_tab->save_image(argv[1])) {
+        cerr << "Could not write " << argv[1] << endl;
+        return 1;
+    }
+
+    return 0;
+}
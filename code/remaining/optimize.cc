@@ -7,7 +7,8 @@
      implemented, only methods in this file should need to be changed. ***/
 
 
-ast_optimizer *optimizer = new ast_optimizer();
+// Set by the compilation_context running on this thread.
+thread_local ast_optimizer *optimizer = NULL;
 
 
 /* The optimizer's interface method. Starts a recursive optimize call down
@@ -65,14 +66,42 @@ void ast_lvalue::optimize()
     fatal("Trying to optimize abstract class ast_lvalue.");
 }
 
+
+
+/* Optimizes the operations and relations of an expression, operands first,
+   see binary_walk in ast.hh. Nothing is passed up the walk. */
+class optimize_walk : public binary_walk
+{
+protected:
+    virtual sym_index leaf(ast_expression *node)
+    {
+        node->optimize();
+        return NULL_SYM;
+    }
+
+    virtual sym_index operation(ast_binaryoperation *node, sym_index, sym_index)
+    {
+        node->optimize_node();
+        return NULL_SYM;
+    }
+
+    virtual sym_index relation(ast_binaryrelation *node, sym_index, sym_index)
+    {
+        node->optimize_node();
+        return NULL_SYM;
+    }
+};
+
 void ast_binaryoperation::optimize()
 {
-    fatal("Trying to optimize abstract class ast_binaryoperation.");
+    optimize_walk walk;
+    walk.run(this);
 }
 
 void ast_binaryrelation::optimize()
 {
-    fatal("Trying to optimize abstract class ast_binaryrelation.");
+    optimize_walk walk;
+    walk.run(this);
 }
 
 
@@ -82,11 +111,10 @@ void ast_binaryrelation::optimize()
 /* Optimize a statement list. */
 void ast_stmt_list::optimize()
 {
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->optimize();
+    for (ast_statement *s : stmts) {
+        if (s != NULL) {
+            s->optimize();
+        }
     }
 }
 
@@ -130,43 +158,44 @@ ast_expression *ast_optimizer::fold_constants(ast_expression *node)
 }
 
 /* All the binary operations should already have been detected in their parent
-   nodes, so we don't need to do anything at all here. */
-void ast_add::optimize()
+   nodes, so we don't need to do anything at all here. Their operands are
+   already optimized when these are called, see optimize_walk above. */
+void ast_add::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_sub::optimize()
+void ast_sub::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_mult::optimize()
+void ast_mult::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_divide::optimize()
+void ast_divide::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_or::optimize()
+void ast_or::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_and::optimize()
+void ast_and::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_idiv::optimize()
+void ast_idiv::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_mod::optimize()
+void ast_mod::optimize_node()
 {
     /* Your code here */
 }
@@ -174,22 +203,22 @@ void ast_mod::optimize()
 
 
 /* We can apply constant folding to binary relations as well. */
-void ast_equal::optimize()
+void ast_equal::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_notequal::optimize()
+void ast_notequal::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_lessthan::optimize()
+void ast_lessthan::optimize_node()
 {
     /* Your code here */
 }
 
-void ast_greaterthan::optimize()
+void ast_greaterthan::optimize_node()
 {
     /* Your code here */
 }
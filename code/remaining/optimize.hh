@@ -15,7 +15,7 @@
 class ast_optimizer;
 
 // Defined in optimize.cc.
-extern ast_optimizer *optimizer;
+extern thread_local ast_optimizer *optimizer;
 
 
 class ast_optimizer
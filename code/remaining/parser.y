@@ -3,37 +3,22 @@
 #include "semantic.hh"
 #include "optimize.hh"
 #include "codegen.hh"
+#include "profile.hh"
+#include "pass.hh"
 
-/* Defined in parser.cc */
-extern char *yytext;
-
-/* Nr of errors encountered so far. Only generate quads & assembler if
-   error_count == 0. Defined in error.cc. */
-extern int error_count;
-
-/* Defined in symtab.cc. */
-extern symbol_table *sym_tab;
-
-/* Defined in semantic.cc. */
-extern semantic *type_checker;
-
-/* Defined in codegen.cc. */
-extern code_generator *code_gen;
-
-/*! From scanner.l output. */
-extern int yylex();
-
-/* Defined in error.hh. */
-extern void yyerror(string);
+/* Quads & assembler are only generated if error_count (the number of errors
+   encountered so far, defined in error.cc) is 0. The error count, sym_tab,
+   type_checker, optimizer and code_gen all belong to the compilation running
+   on this thread, see context.hh. */
 
 /* All these defined in main.cc. They represent some of the flags
    given to the 'diesel' script. */
-extern bool print_ast;
-extern bool print_quads;
-extern bool typecheck;
-extern bool optimize;
-extern bool quads;
-extern bool assembler;
+extern thread_local bool print_ast;
+extern thread_local bool print_quads;
+extern thread_local bool typecheck;
+extern thread_local bool optimize;
+extern thread_local bool quads;
+extern thread_local bool assembler;
 
 #define YYDEBUG 1
 
@@ -43,6 +28,27 @@ extern bool assembler;
 /* #define YYERROR_VERBOSE */
 %}
 
+/* The parser is pure, and gets the reentrant scanner it reads from as an
+   argument, so that several compilations can run at the same time. */
+%define api.pure full
+%locations
+%param { yyscan_t scanner }
+
+%code requires {
+#include "context.hh"
+}
+
+%code {
+/*! From scanner.l output. */
+extern int yylex(YYSTYPE *, YYLTYPE *, yyscan_t);
+
+/*! From scanner.l output. The text of the last token scanned. */
+extern char *yyget_text(yyscan_t);
+
+/* Defined below. */
+void yyerror(YYLTYPE *, yyscan_t, const char *);
+}
+
 
 
 /* The different semantic values that can be returned within the AST. This is
@@ -125,47 +131,68 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    // The name the phases are reported under, with -T.
+                    pool_string block = sym_tab->pool_view(env->id);
 
                     // The status variables here depend on what flags were
                     // passed to the compiler. See the 'diesel' script for
                     // more information.
-                    if (typecheck) {
+                    // Type check and optimize the block a statement at a
+                    // time, unless the AST is to be printed in between.
+                    bool interleaved = typecheck && optimize && !print_ast;
+                    if (interleaved) {
+                        begin_phase(PHASE_TYPECHECK_OPTIMIZE, block);
+                        typecheck_and_optimize(env, $3);
+                        end_phase();
+                    }
+
+                    if (typecheck && !interleaved) {
+                        begin_phase(PHASE_TYPECHECK, block);
                         type_checker->do_typecheck(env, $3);
+                        end_phase();
                     }
 
                     if (print_ast) {
-                        cout << "\nUnoptimized AST for global level" << endl;
-                        cout << (ast_stmt_list *)$3 << endl;
+                        listing() << "\nUnoptimized AST for global level" << endl;
+                        listing() << (ast_stmt_list *)$3 << endl;
                     }
 
-                    if (optimize) {
+                    if (optimize && !interleaved) {
+                        begin_phase(PHASE_OPTIMIZE, block);
                         optimizer->do_optimize($3);
+                        end_phase();
                         if(print_ast) {
-                            cout << "\nOptimized AST for global level" << endl;
-                            cout << (ast_stmt_list *)$3 << endl;
+                            listing() << "\nOptimized AST for global level" << endl;
+                            listing() << (ast_stmt_list *)$3 << endl;
                         }
                     }
                     if (error_count == 0) {
                         if (quads) {
+                            begin_phase(PHASE_QUADS, block);
                             quad_list *q = $1->do_quads($3);
+                            end_phase();
                             if (print_quads) {
-                                cout << "\nQuad list for global level" << endl;
-                                cout << (quad_list *)q << endl;
+                                listing() << "\nQuad list for global level" << endl;
+                                listing() << (quad_list *)q << endl;
                             }
 
                             if (assembler) {
-                                cout << "Generating assembler, global level"
-                                     << endl;
+                                listing() << "Generating assembler, global level"
+                                          << endl;
+                                begin_phase(PHASE_ASSEMBLER, block);
                                 code_gen->generate_assembler(q, env);
+                                end_phase();
                             }
                         }
                     } else {
-                        cout << "Found " << error_count << " errors. "
-                             << "Compilation aborted.\n";
+                        listing() << "Found " << error_count << " errors. "
+                                  << "Compilation aborted.\n";
                     }
 
                     // We close the global scope.
                     sym_tab->close_scope();
+                    // Nothing from the block is used after this.
+                    block_arena->pop_mark();
                 }
                 ;
 
@@ -179,6 +206,9 @@ prog_decl       : prog_head T_SEMICOLON const_part variable_part
 
 prog_head       : T_PROGRAM T_IDENT
                 {
+                    // The AST nodes and quads of the block are released
+                    // once it has been compiled, see arena.hh.
+                    block_arena->push_mark();
                     /* Your code here */
                     sym_tab->open_scope();
                 }
@@ -245,9 +275,7 @@ var_decl        : T_IDENT T_COLON type_id T_SEMICOLON
                     // We enter an array: pool_pointer, type pointer,
                     // the id type of the constant, and the value of the
                     // constant.
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    position_information pos(@1.first_line, @1.first_column);
 
                     // Ideally we should be able to just enter the array and
                     // defer index type checking to the semantic phase.
@@ -270,18 +298,18 @@ var_decl        : T_IDENT T_COLON type_id T_SEMICOLON
                     // but if we don't do it here and NULL is returned (which
                     // shouldn't happen if you've done everything right, but
                     // paranoia never hurts) the compiler would crash.
-                    if(tmp == NULL || tmp->tag != SYM_CONST) {
+                    if(tmp == NULL || tmp->hot->tag != SYM_CONST) {
                         type_error(pos) << "bad index in array declaration: "
-                                        << yytext << endl << flush;
+                                        << yyget_text(scanner) << endl << flush;
                     } else {
                         constant_symbol *con = tmp->get_constant_symbol();
-                        if (con->type == integer_type) {
-                            sym_tab->enter_array(pos,
+                        if (con->hot->type == integer_type) {
+                            sym_tab->enter_array(&pos,
                                                  $1,
                                                  $8->sym_p,
                                                  con->const_value.ival);
                         } else {
-                            sym_tab->enter_array(pos,
+                            sym_tab->enter_array(&pos,
                                                  $1,
                                                  $8->sym_p,
                                                  ILLEGAL_ARRAY_CARD);
@@ -306,97 +334,141 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    // The name the phases are reported under, with -T.
+                    pool_string block = sym_tab->pool_view(env->id);
+
+                    // Type check and optimize the block a statement at a
+                    // time, unless the AST is to be printed in between.
+                    bool interleaved = typecheck && optimize && !print_ast;
+                    if (interleaved) {
+                        begin_phase(PHASE_TYPECHECK_OPTIMIZE, block);
+                        typecheck_and_optimize(env, $3);
+                        end_phase();
+                    }
 
-                    if (typecheck) {
+                    if (typecheck && !interleaved) {
+                        begin_phase(PHASE_TYPECHECK, block);
                         type_checker->do_typecheck(env, $3);
+                        end_phase();
                     }
 
                     if (print_ast) {
-                        cout << "\nUnoptimized AST for \""
-                             << sym_tab->pool_lookup(env->id)
-                             << "\"" << endl;
-                        cout << (ast_stmt_list *)$3 << endl;
+                        listing() << "\nUnoptimized AST for \""
+                                  << sym_tab->pool_view(env->id)
+                                  << "\"" << endl;
+                        listing() << (ast_stmt_list *)$3 << endl;
                     }
 
-                    if (optimize) {
+                    if (optimize && !interleaved) {
+                        begin_phase(PHASE_OPTIMIZE, block);
                         optimizer->do_optimize($3);
+                        end_phase();
                         if (print_ast) {
-                            cout << "\nOptimized AST for \""
-                                 << sym_tab->pool_lookup(env->id)
-                                 << "\"" << endl;
-                            cout << (ast_stmt_list*)$3 << endl;
+                            listing() << "\nOptimized AST for \""
+                                      << sym_tab->pool_view(env->id)
+                                      << "\"" << endl;
+                            listing() << (ast_stmt_list*)$3 << endl;
                         }
                     }
 
                     if (error_count == 0) {
                         if (quads) {
+                            begin_phase(PHASE_QUADS, block);
                             quad_list *q = $1->do_quads($3);
+                            end_phase();
                             if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
+                                listing() << "\nQuad list for \""
+                                          << sym_tab->pool_view(env->id)
+                                          << "\"" << endl;
+                                listing() << (quad_list *)q << endl;
                             }
 
                             if (assembler) {
-                                cout << "Generating assembler for procedure \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
+                                listing() << "Generating assembler for procedure \""
+                                          << sym_tab->pool_view(env->id)
+                                          << "\"" << endl;
+                                begin_phase(PHASE_ASSEMBLER, block);
                                 code_gen->generate_assembler(q, env);
+                                end_phase();
                             }
                         }
                     }
 
                     // Close the current scope.
                     sym_tab->close_scope();
+                    // Frees its AST and quads, but not those of the
+                    // enclosing block, which were there before the mark.
+                    block_arena->pop_mark();
                 }
                 | func_decl subprog_part comp_stmt T_SEMICOLON
                 {
 
                     symbol *env = sym_tab->get_symbol($1->sym_p);
+                    // The name the phases are reported under, with -T.
+                    pool_string block = sym_tab->pool_view(env->id);
+
+                    // Type check and optimize the block a statement at a
+                    // time, unless the AST is to be printed in between.
+                    bool interleaved = typecheck && optimize && !print_ast;
+                    if (interleaved) {
+                        begin_phase(PHASE_TYPECHECK_OPTIMIZE, block);
+                        typecheck_and_optimize(env, $3);
+                        end_phase();
+                    }
 
-                    if (typecheck) {
+                    if (typecheck && !interleaved) {
+                        begin_phase(PHASE_TYPECHECK, block);
                         type_checker->do_typecheck(env, $3);
+                        end_phase();
                     }
 
                     if (print_ast) {
-                        cout << "\nUnoptimized AST for \""
-                             << sym_tab->pool_lookup(env->id)
-                             << "\"" << endl;
-                        cout << (ast_stmt_list *)$3 << endl;
+                        listing() << "\nUnoptimized AST for \""
+                                  << sym_tab->pool_view(env->id)
+                                  << "\"" << endl;
+                        listing() << (ast_stmt_list *)$3 << endl;
                     }
 
-                    if (optimize) {
+                    if (optimize && !interleaved) {
+                        begin_phase(PHASE_OPTIMIZE, block);
                         optimizer->do_optimize($3);
+                        end_phase();
                         if (print_ast) {
-                            cout << "\nOptimized AST for \""
-                                 << sym_tab->pool_lookup(env->id)
-                                 << "\"" << endl;
-                            cout << (ast_stmt_list *)$3 << endl;
+                            listing() << "\nOptimized AST for \""
+                                      << sym_tab->pool_view(env->id)
+                                      << "\"" << endl;
+                            listing() << (ast_stmt_list *)$3 << endl;
                         }
                     }
 
                     if (error_count == 0) {
                         if (quads) {
+                            begin_phase(PHASE_QUADS, block);
                             quad_list *q = $1->do_quads($3);
+                            end_phase();
                             if (print_quads) {
-                                cout << "\nQuad list for \""
-                                     << sym_tab->pool_lookup(env->id)
-                                     << "\"" << endl;
-                                cout << (quad_list *)q << endl;
+                                listing() << "\nQuad list for \""
+                                          << sym_tab->pool_view(env->id)
+                                          << "\"" << endl;
+                                listing() << (quad_list *)q << endl;
                             }
 
                             if (assembler) {
-                                cout << "Generating assembler for function \""
-                                     << sym_tab->pool_lookup(env->id) << "\""
-                                     << endl;
+                                listing() << "Generating assembler for function \""
+                                          << sym_tab->pool_view(env->id) << "\""
+                                          << endl;
+                                begin_phase(PHASE_ASSEMBLER, block);
                                 code_gen->generate_assembler(q, env);
+                                end_phase();
                             }
                         }
                     }
 
                     // Close the current scope.
                     sym_tab->close_scope();
+                    // Frees its AST and quads, but not those of the
+                    // enclosing block, which were there before the mark.
+                    block_arena->pop_mark();
                 }
                 ;
 
@@ -417,11 +489,10 @@ func_decl       : func_head opt_param_list T_COLON type_id T_SEMICOLON const_par
 
 proc_head       : T_PROCEDURE T_IDENT
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    block_arena->push_mark();
+                    position_information pos(@1.first_line, @1.first_column);
                     // We add the function id to the symbol table.
-                    sym_index proc_loc = sym_tab->enter_procedure(pos,
+                    sym_index proc_loc = sym_tab->enter_procedure(&pos,
                                                                   $2);
                     // Open a new scope.
                     sym_tab->open_scope();
@@ -437,11 +508,10 @@ proc_head       : T_PROCEDURE T_IDENT
 
 func_head       : T_FUNCTION T_IDENT
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    block_arena->push_mark();
+                    position_information pos(@1.first_line, @1.first_column);
                     // We add the function id to the symbol table.
-                    sym_index func_loc = sym_tab->enter_function(pos,
+                    sym_index func_loc = sym_tab->enter_function(&pos,
                                                                  $2);
                     // Open a new scope.
                     sym_tab->open_scope();
@@ -485,16 +555,14 @@ param_list      : param
 
 param           : T_IDENT T_COLON type_id
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    position_information pos(@1.first_line, @1.first_column);
 
                     // Enter parameter into the symbol table. The linking of
                     // parameters and things is taken care of in the
                     // enter_parameter function, which is worth taking a
                     // second look at.
                     sym_index param_loc =
-                        sym_tab->enter_parameter(pos,
+                        sym_tab->enter_parameter(&pos,
                                                  $1,
                                                  $3->sym_p);
                 }
@@ -745,9 +813,7 @@ func_call       : func_id T_LEFTPAR opt_expr_list T_RIGHTPAR
 
 integer         : T_INTNUM
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    position_information pos(@1.first_line, @1.first_column);
 
                     // We need to pass on the value AND the position here.
                     $$ = new ast_integer(pos,
@@ -758,9 +824,7 @@ integer         : T_INTNUM
 
 real            : T_REALNUM
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    position_information pos(@1.first_line, @1.first_column);
 
                     // We create a new real constant.
                     $$ = new ast_real(pos,
@@ -777,7 +841,7 @@ type_id         : id
                     if(sym_tab->get_symbol_tag($1->sym_p) != SYM_NAMETYPE) {
                         type_error($1->pos) << "not declared "
                                             << "as type: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -791,7 +855,7 @@ const_id        : id
                     if(sym_tab->get_symbol_tag($1->sym_p) != SYM_CONST) {
                         type_error($1->pos) << "not declared "
                                             << "as constant: "
-                                            << yytext << flush;
+                                            << yyget_text(scanner) << flush;
                     }
                     $$ = $1;
                 }
@@ -806,7 +870,7 @@ lvar_id         : id
                        sym_tab->get_symbol_tag($1->sym_p) != SYM_PARAM) {
                         type_error($1->pos) << "not declared "
                                             << "as variable or parameter: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -821,7 +885,7 @@ rvar_id         : id
                         type_error($1->pos) << "not declared "
                                             << "as variable, parameter or "
                                             << "constant: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -835,7 +899,7 @@ proc_id         : id
                     if (sym_tab->get_symbol_tag($1->sym_p) != SYM_PROC) {
                         type_error($1->pos) << "not declared "
                                             << "as procedure: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -849,7 +913,7 @@ func_id         : id
                     if (sym_tab->get_symbol_tag($1->sym_p) != SYM_FUNC) {
                         type_error($1->pos) << "not declared "
                                             << "as function: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -863,7 +927,7 @@ array_id        : id
                     if (sym_tab->get_symbol_tag($1->sym_p) != SYM_ARRAY) {
                         type_error($1->pos) << "not declared "
                                             << "as array: "
-                                            << yytext << endl << flush;
+                                            << yyget_text(scanner) << endl << flush;
                     }
                     $$ = $1;
                 }
@@ -873,9 +937,7 @@ array_id        : id
 id              : T_IDENT
                 {
                     sym_index sym_p;    // Used to find previous use of symbol.
-                    position_information *pos =
-                        new position_information(@1.first_line,
-                                                 @1.first_column);
+                    position_information pos(@1.first_line, @1.first_column);
 
                     // Make sure the symbol was declared before it is used.
                     sym_p = sym_tab->lookup_symbol($1);
@@ -883,7 +945,7 @@ id              : T_IDENT
                     //            << sym_tab->pool_lookup($1) << endl;
                     if (sym_p == NULL_SYM) {
                         type_error(pos) << "not declared: "
-                                        << yytext << endl << flush;
+                                        << yyget_text(scanner) << endl << flush;
                     }
                     // Create a new ast_id node with pos, symptr.
                     $$ = new ast_id(pos,
@@ -894,3 +956,10 @@ id              : T_IDENT
 
 
 %%
+
+/* Called by bison for syntax errors, with the position of the lookahead
+   token. */
+void yyerror(YYLTYPE *location, yyscan_t, const char *msg)
+{
+    yyerror(location->first_line, msg);
+}
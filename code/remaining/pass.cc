@@ -0,0 +1,66 @@
+#include "pass.hh"
+#include "semantic.hh"
+#include "optimize.hh"
+
+
+/* Type checking a block a statement at a time. */
+void typecheck_pass::begin_block(symbol *, ast_stmt_list *)
+{
+    type_checker->begin_typecheck();
+}
+
+
+void typecheck_pass::statement(ast_statement *s)
+{
+    s->type_check();
+}
+
+
+void typecheck_pass::end_block(symbol *env, ast_stmt_list *body)
+{
+    type_checker->end_typecheck(env, body);
+}
+
+
+/* Optimizing a block a statement at a time. */
+void optimize_pass::statement(ast_statement *s)
+{
+    s->optimize();
+}
+
+
+/* Goes through the statements of the block once, giving each to all the
+   passes in turn. Each pass walks the statement's nodes by itself. Empty
+   statements are skipped, as ast_stmt_list does. */
+void run_passes(block_pass **passes, int count,
+                symbol *env, ast_stmt_list *body)
+{
+    for (int i = 0; i < count; i++) {
+        passes[i]->begin_block(env, body);
+    }
+    if (body != NULL) {
+        for (ast_statement *s : body->stmts) {
+            if (s == NULL) {
+                continue;
+            }
+            for (int i = 0; i < count; i++) {
+                passes[i]->statement(s);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        passes[i]->end_block(env, body);
+    }
+}
+
+
+/* Used by parser.y instead of do_typecheck() and do_optimize(), unless the
+   AST is to be printed in between. */
+void typecheck_and_optimize(symbol *env, ast_stmt_list *body)
+{
+    typecheck_pass check;
+    optimize_pass opt;
+    block_pass *passes[] = { &check, &opt };
+
+    run_passes(passes, 2, env, body);
+}
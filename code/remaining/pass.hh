@@ -0,0 +1,69 @@
+#ifndef __PASS_HH__
+#define __PASS_HH__
+
+#include "ast.hh"
+
+using namespace std;
+
+
+/*! \brief A pass over the statements of a block.
+
+  The per-phase methods of the AST nodes, such as ``type_check()`` and
+  ``optimize()``, each walk a whole statement. run_passes() interleaves
+  passes made of them at the statement level: each statement is given to
+  every pass in turn before it goes on to the next one. Every pass still
+  walks the nodes of the statement itself, so a node is visited once per
+  pass, but the statement is likely to still be in the cache when the
+  later passes get to it. A new pass is added by deriving from this class,
+  and listing it where the passes are run.
+
+  Passes may only be fused like this if what one of them does with a
+  statement doesn't depend on what the others do with later statements.
+ */
+class block_pass
+{
+public:
+    virtual ~block_pass() {}
+
+    //! Called before the first statement of the block.
+    virtual void begin_block(symbol *, ast_stmt_list *) {}
+
+    //! Called for each statement of the block, in order.
+    virtual void statement(ast_statement *) = 0;
+
+    //! Called after the last statement of the block.
+    virtual void end_block(symbol *, ast_stmt_list *) {}
+};
+
+
+//! Type checks a block, as semantic::do_typecheck() does.
+class typecheck_pass : public block_pass
+{
+public:
+    virtual void begin_block(symbol *, ast_stmt_list *);
+
+    virtual void statement(ast_statement *);
+
+    virtual void end_block(symbol *, ast_stmt_list *);
+};
+
+
+//! Optimizes a block, as ast_optimizer::do_optimize() does.
+class optimize_pass : public block_pass
+{
+public:
+    virtual void statement(ast_statement *);
+};
+
+
+/*! Runs count passes over the block env with the given body, a statement
+  at a time. The body may be NULL, if the block is empty. */
+extern void run_passes(block_pass **passes, int count,
+                       symbol *env, ast_stmt_list *body);
+
+/*! Type checks and optimizes a block, each statement being optimized right
+  after it is type checked. The optimizer still only sees statements that
+  have been type checked, as it needs their types. */
+extern void typecheck_and_optimize(symbol *env, ast_stmt_list *body);
+
+#endif
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <new>
+#include <chrono>
+#include <iomanip>
+
+#include "profile.hh"
+
+using namespace std;
+
+// Set by the compilation_context running on this thread, if it profiles.
+thread_local compile_profile *profile = NULL;
+
+// Everything allocated with new on this thread so far. A phase is charged
+// with how much these, and the block arena, grow while it runs.
+static thread_local long allocated_bytes = 0;
+static thread_local long allocated_objects = 0;
+
+static const char *phase_names[NR_PHASES] = {
+    "scan/parse", "typecheck", "optimize", "check+opt", "quads", "assembler"
+};
+
+// Trace timestamps count from here, so the compilations of a batch share a
+// time line.
+static const chrono::steady_clock::time_point start_time =
+    chrono::steady_clock::now();
+
+
+/* Replaces the global operator new, to count the allocations. The array
+   versions, and the default nothrow version, call this one. */
+void *operator new(size_t size)
+{
+    allocated_bytes += size;
+    allocated_objects++;
+
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+
+/* The counterpart of the above. */
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+
+/* Nanoseconds since the compiler started. */
+static long now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start_time).count();
+}
+
+
+/* Returns the bytes and objects allocated on this thread so far, on the
+   heap and in the block arena. */
+static void count_allocated(long &bytes, long &objects)
+{
+    bytes = allocated_bytes;
+    objects = allocated_objects;
+    if (block_arena != NULL) {
+        bytes += block_arena->get_bytes_allocated();
+        objects += block_arena->get_objects_allocated();
+    }
+}
+
+
+/* Starts a phase, inside the one running now, if any. */
+void compile_profile::begin(compile_phase phase, const string &block)
+{
+    running_phase r;
+    r.phase = phase;
+    r.block = block;
+    count_allocated(r.bytes, r.objects);
+    r.inner.time = 0;
+    r.inner.bytes = 0;
+    r.inner.objects = 0;
+    // Last, so that the above isn't charged to the phase.
+    r.start = now();
+    running.push_back(r);
+}
+
+
+/* Ends the phase begun last. What it cost all told counts as a phase
+   inside the one that began it. */
+void compile_profile::end()
+{
+    long stop = now();
+    if (running.empty()) {
+        fatal("compile_profile::end: No phase running");
+    }
+    running_phase &r = running.back();
+
+    cost all;
+    count_allocated(all.bytes, all.objects);
+    all.time = stop - r.start;
+    all.bytes -= r.bytes;
+    all.objects -= r.objects;
+
+    record rec;
+    rec.phase = r.phase;
+    rec.block = r.block;
+    rec.start = r.start;
+    rec.duration = all.time;
+    rec.self.time = all.time - r.inner.time;
+    rec.self.bytes = all.bytes - r.inner.bytes;
+    rec.self.objects = all.objects - r.inner.objects;
+    records.push_back(rec);
+
+    running.pop_back();
+    if (!running.empty()) {
+        cost &inner = running.back().inner;
+        inner.time += all.time;
+        inner.bytes += all.bytes;
+        inner.objects += all.objects;
+    }
+}
+
+
+/* Ends the phases that are still running, innermost first. */
+void compile_profile::end_all()
+{
+    while (!running.empty()) {
+        end();
+    }
+}
+
+
+/* Prints one line of the report. */
+static void report_line(ostream &o, const string &block, const char *phase,
+                        long time, long bytes, long objects)
+{
+    o << left << setw(20) << block << ' ' << setw(12) << phase
+      << right << fixed << setprecision(3) << setw(12) << time / 1e6
+      << setw(14) << bytes << setw(11) << objects << '\n';
+}
+
+
+/* Prints what each phase cost for each block, in the order they ran, and
+   then for all of them. Scanning and parsing is only given in total. */
+void compile_profile::report(ostream &o)
+{
+    cost total[NR_PHASES] = {};
+    cost all = {};
+
+    o << "\nPhase timing (ms), and memory allocated (bytes and objects)\n"
+      << left << setw(20) << "Block" << ' ' << setw(12) << "Phase"
+      << right << setw(12) << "Time" << setw(14) << "Bytes"
+      << setw(11) << "Objects" << '\n'
+      << string(69, '-') << '\n';
+    for (size_t i = 0; i < records.size(); i++) {
+        const record &r = records[i];
+        if (!r.block.empty()) {
+            report_line(o, r.block, phase_names[r.phase], r.self.time,
+                        r.self.bytes, r.self.objects);
+        }
+        total[r.phase].time += r.self.time;
+        total[r.phase].bytes += r.self.bytes;
+        total[r.phase].objects += r.self.objects;
+        all.time += r.self.time;
+        all.bytes += r.self.bytes;
+        all.objects += r.self.objects;
+    }
+    o << string(69, '-') << '\n';
+    for (int p = 0; p < NR_PHASES; p++) {
+        report_line(o, "All blocks", phase_names[p], total[p].time,
+                    total[p].bytes, total[p].objects);
+    }
+    report_line(o, "Total", "", all.time, all.bytes, all.objects);
+    o.unsetf(ios::floatfield);
+}
+
+
+/* Writes s as a JSON string. */
+static void write_json_string(ostream &o, const string &s)
+{
+    o << '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+            o << '\\' << c;
+        } else if (c < ' ') {
+            o << "\\u" << hex << setw(4) << setfill('0') << (int) c
+              << dec << setfill(' ');
+        } else {
+            o << c;
+        }
+    }
+    o << '"';
+}
+
+
+/* Writes the phases as complete ("X") events of the Chrome trace format,
+   which chrome://tracing and Perfetto show as nested bars. The compilation
+   is a process of its own in the trace. */
+void compile_profile::write_trace(ostream &o, int pid, const string &name)
+{
+    o << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid
+      << ", \"tid\": 1, \"args\": {\"name\": ";
+    write_json_string(o, name);
+    o << "}}";
+
+    o << fixed << setprecision(3);
+    for (size_t i = 0; i < records.size(); i++) {
+        const record &r = records[i];
+        o << ",\n{\"name\": \"" << phase_names[r.phase]
+          << "\", \"cat\": \"compiler\", \"ph\": \"X\", \"ts\": "
+          << r.start / 1e3 << ", \"dur\": " << r.duration / 1e3
+          << ", \"pid\": " << pid << ", \"tid\": 1, \"args\": {\"block\": ";
+        write_json_string(o, r.block);
+        o << ", \"bytes\": " << r.self.bytes
+          << ", \"objects\": " << r.self.objects << "}}";
+    }
+    o.unsetf(ios::floatfield);
+}
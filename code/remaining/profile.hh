@@ -0,0 +1,117 @@
+#ifndef __PROFILE_HH__
+#define __PROFILE_HH__
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "symtab.hh"
+
+using namespace std;
+
+/* The phases of a compilation. Everything but scanning and parsing is done
+   a block at a time, from the actions in parser.y. Type checking and
+   optimization are usually one phase, see pass.hh. */
+enum compile_phases {
+    PHASE_PARSE,
+    PHASE_TYPECHECK,
+    PHASE_OPTIMIZE,
+    PHASE_TYPECHECK_OPTIMIZE,
+    PHASE_QUADS,
+    PHASE_ASSEMBLER,
+    NR_PHASES
+};
+
+typedef enum compile_phases compile_phase;
+
+
+/*! \brief What the phases of a compilation cost.
+
+  Records the wall time of every phase, and the bytes and objects allocated
+  with ``new`` meanwhile. Phases nest, as all of them run while parsing;
+  each is charged only with what isn't spent in the phases inside it.
+ */
+class compile_profile
+{
+private:
+    // The cost of (a part of) a phase. Time is in nanoseconds.
+    struct cost {
+        long time;
+        long bytes;
+        long objects;
+    };
+
+    // A phase that is done.
+    struct record {
+        compile_phase phase;
+        string block;
+        long start;
+        long duration;
+        // Not counting the phases inside it.
+        cost self;
+    };
+
+    // A phase that is running, and what the phases inside it cost.
+    struct running_phase {
+        compile_phase phase;
+        string block;
+        long start;
+        long bytes;
+        long objects;
+        cost inner;
+    };
+
+    vector<record> records;
+    vector<running_phase> running;
+
+public:
+    //! Starts a phase, for the named block or for the whole program.
+    void begin(compile_phase, const string &block);
+
+    //! Ends the phase begun last.
+    void end();
+
+    //! Ends every phase still running, when a fatal error stopped them.
+    void end_all();
+
+    //! Prints the cost of each phase of each block, and the totals.
+    void report(ostream &);
+
+    /*! Writes the phases as Chrome trace events, separated by commas, as
+      process pid, named name. */
+    void write_trace(ostream &, int pid, const string &name);
+};
+
+// Defined in profile.cc. The profile of the compilation on this thread, or
+// NULL if it isn't profiled.
+extern thread_local compile_profile *profile;
+
+
+/* Used around the phases. They do nothing unless the compilation is
+   profiled. */
+
+//! Starts a phase of the whole program.
+inline void begin_phase(compile_phase phase)
+{
+    if (profile != NULL) {
+        profile->begin(phase, "");
+    }
+}
+
+//! Starts a phase of a block.
+inline void begin_phase(compile_phase phase, const pool_string &block)
+{
+    if (profile != NULL) {
+        profile->begin(phase, string(block.chars, block.length));
+    }
+}
+
+//! Ends the phase begun last.
+inline void end_phase()
+{
+    if (profile != NULL) {
+        profile->end();
+    }
+}
+
+#endif
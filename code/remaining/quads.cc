@@ -120,6 +120,54 @@ sym_index ast_elsif_list::generate_quads(quad_list &q)
 
 
 
+/* Generates the quads of the operations and relations of an expression,
+   operands first, see binary_walk in ast.hh. Each is given the sym_indexes
+   returned for its operands, where their values end up. */
+class quad_walk : public binary_walk
+{
+private:
+    quad_list &q;
+
+protected:
+    virtual sym_index leaf(ast_expression *node)
+    {
+        return node->generate_quads(q);
+    }
+
+    virtual sym_index operation(ast_binaryoperation *node,
+                                sym_index left_pos,
+                                sym_index right_pos)
+    {
+        return node->generate_quads_node(q, left_pos, right_pos);
+    }
+
+    virtual sym_index relation(ast_binaryrelation *node,
+                               sym_index left_pos,
+                               sym_index right_pos)
+    {
+        return node->generate_quads_node(q, left_pos, right_pos);
+    }
+
+public:
+    quad_walk(quad_list &q) : q(q) {}
+};
+
+/* The binary operations and relations are walked rather than recursed
+   into, so that expressions can be arbitrarily deep. */
+sym_index ast_binaryoperation::generate_quads(quad_list &q)
+{
+    quad_walk walk(q);
+    return walk.run(this);
+}
+
+sym_index ast_binaryrelation::generate_quads(quad_list &q)
+{
+    quad_walk walk(q);
+    return walk.run(this);
+}
+
+
+
 /* Here come the concrete classes. First the leaf nodes. Note that the
    return value of all these quads is an index to the temporary variable in
    which will be stored the the result the node will generate,
@@ -190,56 +238,72 @@ sym_index ast_cast::generate_quads(quad_list &q)
 }
 
 
-sym_index ast_add::generate_quads(quad_list &q)
+sym_index ast_add::generate_quads_node(quad_list &q,
+                                       sym_index left_pos,
+                                       sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_sub::generate_quads(quad_list &q)
+sym_index ast_sub::generate_quads_node(quad_list &q,
+                                       sym_index left_pos,
+                                       sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_mult::generate_quads(quad_list &q)
+sym_index ast_mult::generate_quads_node(quad_list &q,
+                                        sym_index left_pos,
+                                        sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_divide::generate_quads(quad_list &q)
+sym_index ast_divide::generate_quads_node(quad_list &q,
+                                          sym_index left_pos,
+                                          sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_idiv::generate_quads(quad_list &q)
+sym_index ast_idiv::generate_quads_node(quad_list &q,
+                                        sym_index left_pos,
+                                        sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_mod::generate_quads(quad_list &q)
+sym_index ast_mod::generate_quads_node(quad_list &q,
+                                       sym_index left_pos,
+                                       sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_or::generate_quads(quad_list &q)
+sym_index ast_or::generate_quads_node(quad_list &q,
+                                      sym_index left_pos,
+                                      sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_and::generate_quads(quad_list &q)
+sym_index ast_and::generate_quads_node(quad_list &q,
+                                       sym_index left_pos,
+                                       sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
@@ -248,28 +312,36 @@ sym_index ast_and::generate_quads(quad_list &q)
 
 
 
-sym_index ast_equal::generate_quads(quad_list &q)
+sym_index ast_equal::generate_quads_node(quad_list &q,
+                                         sym_index left_pos,
+                                         sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_notequal::generate_quads(quad_list &q)
+sym_index ast_notequal::generate_quads_node(quad_list &q,
+                                            sym_index left_pos,
+                                            sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_lessthan::generate_quads(quad_list &q)
+sym_index ast_lessthan::generate_quads_node(quad_list &q,
+                                            sym_index left_pos,
+                                            sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
     return NULL_SYM;
 }
 
-sym_index ast_greaterthan::generate_quads(quad_list &q)
+sym_index ast_greaterthan::generate_quads_node(quad_list &q,
+                                               sym_index left_pos,
+                                               sym_index right_pos)
 {
     USE_Q;
     /* Your code here */
@@ -322,10 +394,11 @@ sym_index ast_assign::generate_quads(quad_list &q)
 
 
 /* Parameters need to be treated specially as well. What we do here is
-   to recurse from the last parameter forward. In this process we use the
-   nr_param pointer (which is incremented by one for each recursive call)
-   to get the total number of parameters so we can generate a correct q_call
-   quad for the new function/procedure that the parameters belong to.
+   to go from the last parameter forward, the last element of exprs first.
+   In this process we use the nr_param pointer (which is incremented by one
+   for each parameter) to get the total number of parameters so we can
+   generate a correct q_call quad for the new function/procedure that the
+   parameters belong to.
     */
 void ast_expr_list::generate_parameter_list(quad_list &q,
         parameter_symbol *last_param,
@@ -429,15 +502,13 @@ sym_index ast_indexed::generate_quads(quad_list &q)
 }
 
 
-/* Generate quads for a list of statements. Note that this is not necessarily
-   the most efficient way to do it... Why not? */
+/* Generate quads for a list of statements, in order. */
 sym_index ast_stmt_list::generate_quads(quad_list &q)
 {
-    if (preceding != NULL) {
-        preceding->generate_quads(q);
-    }
-    if (last_stmt != NULL) {
-        last_stmt->generate_quads(q);
+    for (ast_statement *s : stmts) {
+        if (s != NULL) {
+            s->generate_quads(q);
+        }
     }
     return NULL_SYM;
 }
@@ -66,6 +66,10 @@ private:
     void print(ostream &);
 
 public:
+    // Placed in the block_arena, see arena.hh.
+    static void *operator new(size_t size) { return block_allocate(size); }
+    static void operator delete(void *) {}
+
     quad_op_type op_code;
     // NOTE: Get rid of the ones we won't need later... int3?
     sym_index sym1;
@@ -96,6 +100,10 @@ public:
 class quad_list_element
 {
 public:
+    // Placed in the block_arena, see arena.hh.
+    static void *operator new(size_t size) { return block_allocate(size); }
+    static void operator delete(void *) {}
+
     quadruple         *data;
     quad_list_element *next;
 
@@ -141,6 +149,10 @@ private:
     void print(ostream &);
 
 public:
+    // Placed in the block_arena, see arena.hh.
+    static void *operator new(size_t size) { return block_allocate(size); }
+    static void operator delete(void *) {}
+
     // Label marking the end of a quad list.
     int last_label;
 
@@ -74,12 +74,4 @@ typedef struct {
 
 #define NR_SYMS   83  // Total no. of grammar symbols
 
-/*!
-  Contains the additional attributes needed to describe certain tokens
-  (integers, reals, string constants, and identifiers).
-  */
-extern YYSTYPE yylval;
-//! Contains variables for tracking position in the source code.
-extern YYLTYPE yylloc;
-
 #endif
@@ -1,29 +1,45 @@
 #include "semantic.hh"
 
 
-semantic *type_checker = new semantic();
+// Set by the compilation_context running on this thread.
+thread_local semantic *type_checker = NULL;
 
 
 /* Used to check that all functions contain return statements.
    Static means that it is only visible inside this file.
-   It is set to false in do_typecheck() (ie, every time we start type checking
-   a new block) and set to true if we find an ast_return node. See below. */
-static bool has_return = false;
+   It is set to false in begin_typecheck() (ie, every time we start type
+   checking a new block) and set to true if we find an ast_return node. See
+   below. */
+static thread_local bool has_return = false;
 
 
 /* Interface for type checking a block of code represented as an AST node. */
 void semantic::do_typecheck(symbol *env, ast_stmt_list *body)
 {
-    // Reset the variable, since we're checking a new block of code.
-    has_return = false;
+    begin_typecheck();
     if (body) {
         body->type_check();
     }
+    end_typecheck(env, body);
+}
+
+
+/* Starts type checking a new block, a statement at a time or all at once.
+   See typecheck_pass in pass.hh. */
+void semantic::begin_typecheck()
+{
+    // Reset the variable, since we're checking a new block of code.
+    has_return = false;
+}
 
+
+/* Finishes type checking a block, when all its statements are checked. */
+void semantic::end_typecheck(symbol *env, ast_stmt_list *body)
+{
     // This is the only case we need this variable for - a function lacking
     // a return statement. All other cases are already handled in
     // ast_return::type_check(); see below.
-    if (env->tag == SYM_FUNC && !has_return) {
+    if (env->hot->tag == SYM_FUNC && !has_return) {
         // Note: We could do this by overloading the do_typecheck() method -
         // one for ast_procedurehead and one for ast_functionhead, but this
         // will do... Hopefully people won't write empty functions often,
@@ -84,16 +100,44 @@ sym_index ast_lvalue::type_check()
     return void_type;
 }
 
+
+
+/* Type checks the operations and relations of an expression, operands
+   first, see binary_walk in ast.hh. Each is given the types of its
+   operands. */
+class typecheck_walk : public binary_walk
+{
+protected:
+    virtual sym_index leaf(ast_expression *node)
+    {
+        return node->type_check();
+    }
+
+    virtual sym_index operation(ast_binaryoperation *node,
+                                sym_index left_type,
+                                sym_index right_type)
+    {
+        return node->type_check_node(left_type, right_type);
+    }
+
+    virtual sym_index relation(ast_binaryrelation *node,
+                               sym_index left_type,
+                               sym_index right_type)
+    {
+        return node->type_check_node(left_type, right_type);
+    }
+};
+
 sym_index ast_binaryoperation::type_check()
 {
-    fatal("Trying to type check abstract class ast_binaryoperation.");
-    return void_type;
+    typecheck_walk walk;
+    return walk.run(this);
 }
 
 sym_index ast_binaryrelation::type_check()
 {
-    fatal("Trying to type check abstract class ast_binaryrelation.");
-    return void_type;
+    typecheck_walk walk;
+    return walk.run(this);
 }
 
 
@@ -101,11 +145,10 @@ sym_index ast_binaryrelation::type_check()
 /* Type check a list of statements. */
 sym_index ast_stmt_list::type_check()
 {
-    if (preceding != NULL) {
-        preceding->type_check();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->type_check();
+    for (ast_statement *s : stmts) {
+        if (s != NULL) {
+            s->type_check();
+        }
     }
     return void_type;
 }
@@ -133,7 +176,7 @@ sym_index ast_elsif_list::type_check()
    itself in the symbol table as far as typechecking is concerned. */
 sym_index ast_id::type_check()
 {
-    if (sym_tab->get_symbol(sym_p)->tag != SYM_NAMETYPE) {
+    if (sym_tab->get_symbol_tag(sym_p) != SYM_NAMETYPE) {
         return type;
     }
     return sym_p;
@@ -150,26 +193,32 @@ sym_index ast_indexed::type_check()
 
 /* This convenience function is used to type check all binary operations
    in which implicit casting of integer to real is done: plus, minus,
-   multiplication. We synthesize type information as well. */
-sym_index semantic::check_binop1(ast_binaryoperation *node)
+   multiplication. We synthesize type information as well. The types of the
+   operands are those type_check_node() is given. */
+sym_index semantic::check_binop1(ast_binaryoperation *node,
+                                 sym_index left_type,
+                                 sym_index right_type)
 {
     /* Your code here */
     return void_type; // You don't have to use this method but it might be convenient
 }
 
-sym_index ast_add::type_check()
+sym_index ast_add::type_check_node(sym_index left_type,
+                                   sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_sub::type_check()
+sym_index ast_sub::type_check_node(sym_index left_type,
+                                   sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_mult::type_check()
+sym_index ast_mult::type_check_node(sym_index left_type,
+                                    sym_index right_type)
 {
     /* Your code here */
     return void_type;
@@ -177,7 +226,8 @@ sym_index ast_mult::type_check()
 
 /* Divide is a special case, since it always returns real. We make sure the
    operands are cast to real too as needed. */
-sym_index ast_divide::type_check()
+sym_index ast_divide::type_check_node(sym_index left_type,
+                                      sym_index right_type)
 {
     /* Your code here */
     return void_type;
@@ -187,35 +237,42 @@ sym_index ast_divide::type_check()
 
 /* This convenience method is used to type check all binary operations
    which only accept integer operands: AND, OR, MOD, DIV.
-   The second argument is the name of the operator, so we can generate a
+   The last argument is the name of the operator, so we can generate a
    good error message.
    All of these return integers, so we synthesize that.
    */
-sym_index semantic::check_binop2(ast_binaryoperation *node, string s)
+sym_index semantic::check_binop2(ast_binaryoperation *node,
+                                 sym_index left_type,
+                                 sym_index right_type,
+                                 string s)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_or::type_check()
+sym_index ast_or::type_check_node(sym_index left_type,
+                                  sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_and::type_check()
+sym_index ast_and::type_check_node(sym_index left_type,
+                                   sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_idiv::type_check()
+sym_index ast_idiv::type_check_node(sym_index left_type,
+                                    sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_mod::type_check()
+sym_index ast_mod::type_check_node(sym_index left_type,
+                                   sym_index right_type)
 {
     /* Your code here */
     return void_type;
@@ -225,31 +282,37 @@ sym_index ast_mod::type_check()
 
 /* Convienience method for all binary relations, since they're all typechecked
    the same way. They all return integer types, 1 = true, 0 = false. */
-sym_index semantic::check_binrel(ast_binaryrelation *node)
+sym_index semantic::check_binrel(ast_binaryrelation *node,
+                                 sym_index left_type,
+                                 sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_equal::type_check()
+sym_index ast_equal::type_check_node(sym_index left_type,
+                                     sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_notequal::type_check()
+sym_index ast_notequal::type_check_node(sym_index left_type,
+                                        sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_lessthan::type_check()
+sym_index ast_lessthan::type_check_node(sym_index left_type,
+                                        sym_index right_type)
 {
     /* Your code here */
     return void_type;
 }
 
-sym_index ast_greaterthan::type_check()
+sym_index ast_greaterthan::type_check_node(sym_index left_type,
+                                           sym_index right_type)
 {
     /* Your code here */
     return void_type;
@@ -308,7 +371,7 @@ sym_index ast_return::type_check()
     symbol *tmp = sym_tab->get_symbol(sym_tab->current_environment());
     if (value == NULL) {
         // If the return value is NULL,
-        if (tmp->tag != SYM_PROC)
+        if (tmp->hot->tag != SYM_PROC)
             // ...and we're not inside a procedure, something is wrong.
         {
             type_error(pos) << "Must return a value from a function.\n";
@@ -319,7 +382,7 @@ sym_index ast_return::type_check()
     sym_index value_type = value->type_check();
 
     // The return value is not NULL,
-    if (tmp->tag != SYM_FUNC) {
+    if (tmp->hot->tag != SYM_FUNC) {
         // ...so if we're not inside a function, something is wrong too.
         type_error(pos) << "Procedures may not return a value.\n";
         return void_type;
@@ -330,7 +393,7 @@ sym_index ast_return::type_check()
 
     // Must make sure that the return type matches the function's
     // declared return type.
-    if (func->type != value_type) {
+    if (func->hot->type != value_type) {
         type_error(value->pos) << "Bad return type from function.\n";
     }
 
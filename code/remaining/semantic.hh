@@ -7,7 +7,7 @@ class semantic;
 
 
 // Defined in semantic.cc.
-extern semantic *type_checker;
+extern thread_local semantic *type_checker;
 
 
 class semantic
@@ -35,6 +35,13 @@ public:
     */
     void do_typecheck(symbol *env, ast_stmt_list *body);
 
+    /*! Starts type checking a block whose statements are checked one at a
+      time, by a typecheck_pass; see pass.hh. */
+    void begin_typecheck();
+
+    //! Finishes type checking a block begun with begin_typecheck().
+    void end_typecheck(symbol *env, ast_stmt_list *body);
+
     // Perform type checking on a procedure/function/program body. Note that
     // the body is represented as an ast_stmt_list. See the productions for
     // comp_stmt and subprog_decl in parser.y.
@@ -42,11 +49,11 @@ public:
     // one for binary_relations, one for conditions (new abstract ast_node?),
     // one for expressions that aren't one of the above? Hmmm...
 
-    sym_index check_binop1(ast_binaryoperation *);
+    sym_index check_binop1(ast_binaryoperation *, sym_index, sym_index);
 
-    sym_index check_binop2(ast_binaryoperation *, string);
+    sym_index check_binop2(ast_binaryoperation *, sym_index, sym_index, string);
 
-    sym_index check_binrel(ast_binaryrelation *);
+    sym_index check_binrel(ast_binaryrelation *, sym_index, sym_index);
 };
 
 #endif
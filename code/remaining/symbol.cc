@@ -6,12 +6,12 @@
 
 
 /* Symbol superclass constructor. */
-symbol::symbol(pool_index pool_p)
+symbol::symbol(pool_index pool_p, sym_type kind_p)
 {
     id = pool_p;
-    // All symbols are tagged as SYM_UNDEF at creation.
-    // This is used later to check for redeclarations.
-    tag = SYM_UNDEF;
+    kind = kind_p;
+    // The hot fields are set up by symbol_table::install_symbol().
+    hot = NULL;
 }
 
 
@@ -22,7 +22,7 @@ symbol::symbol(pool_index pool_p)
    will be used a lot in this lab course, so you might as well get used
    to it right away, even if it is new to you. */
 constant_symbol::constant_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    symbol(pool_p, SYM_CONST)
 {
     // Since the const_value is a union of int and float (since a constant can
     // be both integer and real), we just pick one of them arbitrarily and
@@ -34,14 +34,14 @@ constant_symbol::constant_symbol(const pool_index pool_p) :
 /* Constructor for variable_symbol. */
 /* NOTE: Maybe always set the type to void_type here, too? */
 variable_symbol::variable_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    symbol(pool_p, SYM_VAR)
 {
 }
 
 
 /* Constructor for array_symbol. */
 array_symbol::array_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    symbol(pool_p, SYM_ARRAY)
 {
     // Illegal, must be changed later.
     index_type = void_type;
@@ -51,16 +51,18 @@ array_symbol::array_symbol(const pool_index pool_p) :
 
 /* Constructor for parameter_symbol. */
 parameter_symbol::parameter_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    symbol(pool_p, SYM_PARAM)
 {
     size = 0;
     preceding = NULL;
 }
 
 
-/* Constructor for procedure_symbol. */
-procedure_symbol::procedure_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+/* Constructor for callable_symbol, the common part of procedures and
+   functions. */
+callable_symbol::callable_symbol(const pool_index pool_p,
+                                 const sym_type kind_p) :
+    symbol(pool_p, kind_p)
 {
     ar_size = 0;
     label_nr = 0;
@@ -68,19 +70,23 @@ procedure_symbol::procedure_symbol(const pool_index pool_p) :
 }
 
 
+/* Constructor for procedure_symbol. */
+procedure_symbol::procedure_symbol(const pool_index pool_p) :
+    callable_symbol(pool_p, SYM_PROC)
+{
+}
+
+
 /* Constructor for function_symbol. */
 function_symbol::function_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    callable_symbol(pool_p, SYM_FUNC)
 {
-    ar_size = 0;
-    label_nr = 0;
-    last_parameter = NULL;
 }
 
 
 /* Constructor for nametype_symbol. */
 nametype_symbol::nametype_symbol(const pool_index pool_p) :
-    symbol(pool_p)
+    symbol(pool_p, SYM_NAMETYPE)
 {
 }
 
@@ -91,7 +97,7 @@ nametype_symbol::nametype_symbol(const pool_index pool_p) :
 
 // This is the default detail level of information given when printing a
 // symbol.
-symbol::format_type symbol::output_format = symbol::LONG_FORMAT;
+thread_local symbol::format_type symbol::output_format = symbol::LONG_FORMAT;
 
 
 /* Prints information common to all symbols. The various subclasses add on
@@ -101,15 +107,15 @@ void symbol::print(ostream &o)
     switch (output_format) {
     case LONG_FORMAT:
         o << "symbol:" << endl;
-        o << "  id:        " << sym_tab->pool_lookup(id) << endl;
+        o << "  id:        " << sym_tab->pool_view(id) << endl;
         o << "  type:      " << short_symbols
-          << sym_tab->get_symbol(type) << long_symbols << endl;
-        o << "  level:     " << level << endl;
+          << sym_tab->get_symbol(hot->type) << long_symbols << endl;
+        o << "  level:     " << hot->level << endl;
         o << "  hash_link: " << hash_link << endl;
         o << "  back_link: " << back_link << endl;
-        o << "  offset:    " << offset << endl;
+        o << "  offset:    " << hot->offset << endl;
         o << "  tag:       ";
-        switch (tag) {
+        switch (hot->tag) {
         case SYM_UNDEF:
             o << "SYM_UNDEF ";
             break;
@@ -138,7 +144,7 @@ void symbol::print(ostream &o)
         o << endl;
         break;
     case SUMMARY_FORMAT:
-        switch (tag) {
+        switch (hot->tag) {
         case SYM_UNDEF:
             o << "(SYM_UNDEF) ";
             break;
@@ -164,10 +170,10 @@ void symbol::print(ostream &o)
             o << "(SYM_NAMETYPE) ";
             break;
         }
-        o << sym_tab->pool_lookup(id);
+        o << sym_tab->pool_view(id);
         break;
     case SHORT_FORMAT:
-        o << sym_tab->pool_lookup(id);
+        o << sym_tab->pool_view(id);
         break;
     default:
         fatal("Bad output format in symbol::print()");
@@ -176,14 +182,38 @@ void symbol::print(ostream &o)
 }
 
 
-/* Output stream operator for easy printing of symbol information. */
+/* Output stream operator for easy printing of symbol information. The
+   print methods aren't virtual, so call the one for the symbol's kind. */
 ostream &operator<<(ostream &o, symbol *sym)
 {
     if (sym == NULL) {
         return o << "(null)" << endl;
     }
 
-    sym->print(o);
+    switch (sym->kind) {
+    case SYM_CONST:
+        static_cast<constant_symbol *>(sym)->print(o);
+        break;
+    case SYM_VAR:
+        static_cast<variable_symbol *>(sym)->print(o);
+        break;
+    case SYM_ARRAY:
+        static_cast<array_symbol *>(sym)->print(o);
+        break;
+    case SYM_PARAM:
+        static_cast<parameter_symbol *>(sym)->print(o);
+        break;
+    case SYM_PROC:
+    case SYM_FUNC:
+        static_cast<callable_symbol *>(sym)->print(o);
+        break;
+    case SYM_NAMETYPE:
+        static_cast<nametype_symbol *>(sym)->print(o);
+        break;
+    default:
+        sym->print(o);
+        break;
+    }
     return o;
 }
 
@@ -197,7 +227,7 @@ void constant_symbol::print(ostream &o)
     switch (output_format) {
     case LONG_FORMAT:
         o << "  class:     constant_symbol" << endl;
-        if (type == integer_type) {
+        if (hot->type == integer_type) {
             o << "  const_value.ival:" << const_value.ival << endl;
         } else {
             o << "  const_value.rval:" << const_value.rval << endl;
@@ -269,11 +299,11 @@ void parameter_symbol::print(ostream &o)
         if (preceding == NULL) {
             o << "  preceding: NULL" << endl;
         } else
-            o << "  preceding: " << sym_tab->pool_lookup(preceding->id)
+            o << "  preceding: " << sym_tab->pool_view(preceding->id)
               << endl;
         break;
     case SUMMARY_FORMAT:
-        o << " <-- " << sym_tab->pool_lookup(preceding->id);
+        o << " <-- " << sym_tab->pool_view(preceding->id);
         break;
     case SHORT_FORMAT:
         break;
@@ -285,65 +315,19 @@ void parameter_symbol::print(ostream &o)
 
 
 
-/* Print data about a procedure. Helps debugging a lot. See the stream operator
-   though, that's the easiest way to get this info printed. */
-void procedure_symbol::print(ostream &o)
+/* Print data about a procedure or function. Helps debugging a lot. See the
+   stream operator though, that's the easiest way to get this info printed. */
+void callable_symbol::print(ostream &o)
 {
     symbol::print(o);
 
     switch (output_format) {
     case LONG_FORMAT:
-        o << "  class:     procedure_symbol" << endl;
-        o << "  ar_size:   " << ar_size << endl;
-        o << "  label_nr:  " << label_nr << endl;
-        o << "  params:    ";
-
-        if (last_parameter == NULL) {
-            o << "None" << endl;
+        if (kind == SYM_FUNC) {
+            o << "  class:     function_symbol" << endl;
         } else {
-            parameter_symbol *tmp = last_parameter;
-            o << short_symbols;
-            while (tmp != NULL) {
-                o << tmp << " ";
-                tmp = tmp->preceding;
-            }
-            o << long_symbols << endl;
-        }
-        break;
-    case SUMMARY_FORMAT: {
-        o << "(";
-        parameter_symbol *tmp = last_parameter;
-        o << short_symbols;
-        while (tmp != NULL) {
-            o << tmp;
-            tmp = tmp->preceding;
-            if (tmp != NULL) {
-                o << ", ";
-            }
+            o << "  class:     procedure_symbol" << endl;
         }
-        o << summary_symbols;
-        o << ")";
-        break;
-    }
-    case SHORT_FORMAT:
-        break;
-    default:
-        fatal("Bad output format in procedure_symbol::print()");
-        break;
-    }
-}
-
-
-
-/* Print data about a function. Helps debugging a lot. See the stream operator
-   though, that's the easiest way to get this info printed. */
-void function_symbol::print(ostream &o)
-{
-    symbol::print(o);
-
-    switch (output_format) {
-    case LONG_FORMAT:
-        o << "  class:     function_symbol" << endl;
         o << "  ar_size:   " << ar_size << endl;
         o << "  label_nr:  " << label_nr << endl;
         o << "  params:    ";
@@ -371,14 +355,19 @@ void function_symbol::print(ostream &o)
                 o << ", ";
             }
         }
-        o << ") returns " << sym_tab->get_symbol(type)
-          << summary_symbols;
+        if (kind == SYM_FUNC) {
+            o << ") returns " << sym_tab->get_symbol(hot->type)
+              << summary_symbols;
+        } else {
+            o << summary_symbols;
+            o << ")";
+        }
         break;
     }
     case SHORT_FORMAT:
         break;
     default:
-        fatal("Bad output format in function_symbol::print()");
+        fatal("Bad output format in callable_symbol::print()");
         break;
     }
 }
@@ -6,17 +6,29 @@
 #include <iostream>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "symtab.hh"
 
 using namespace std;
 
 /*** Global variables ***/
 
-// The symbol table is a table of pointers to symbol (which can be of various types)
-symbol_table *sym_tab = new symbol_table();
-sym_index void_type;
-sym_index integer_type;
-sym_index real_type;
+// The symbol table is a table of pointers to symbol (which can be of various
+// types). Each thread has its own: the compiler points it at the table of the
+// compilation it is running (see compilation_context), the labs just use one.
+#if defined(LAB1) || defined(LAB2)
+thread_local symbol_table *sym_tab = new symbol_table();
+#else
+thread_local symbol_table *sym_tab = NULL;
+#endif
+thread_local sym_index void_type;
+thread_local sym_index integer_type;
+thread_local sym_index real_type;
 
 
 
@@ -25,7 +37,7 @@ sym_index real_type;
 /* Constructor: allocates the data members. The symbol table itself is just
    a table of pointers to symbols. This is due to the various subclasses of
    symbols used. */
-symbol_table::symbol_table()
+symbol_table::symbol_table(const char *prelude)
 {
     // --- Initialize string pool. ---
     /* The string pool (String table) will
@@ -44,27 +56,53 @@ symbol_table::symbol_table()
     string_pool = new char[pool_length];
     string_pool[0] = '\0';
 
+    // --- Initialize intern table. ---
+    intern_size = BASE_INTERN_SIZE;
+    intern_count = 0;
+    intern_table = new intern_entry[intern_size];
+
     // --- Initialize hash table. ---
-    hash_table = new sym_index[MAX_HASH];
-    for (int i = 0; i < MAX_HASH; i++) {
+    // It shares its slots with the intern table.
+    hash_table = new sym_index[intern_size];
+    pool_slots = new pool_slot_entry[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i].pool_p = -1;
         hash_table[i] = NULL_SYM;
+        pool_slots[i].pool_p = -1;
     }
+    last_installed = -1;
 
     // --- Initialize display. ---
     // The block_table will keep track of the current lexical level
     // global level is 0
     current_level = 0;
-    block_table = new sym_index[MAX_BLOCK];
-    for (int i = 0; i < MAX_BLOCK; i++) {
+    block_size = BASE_BLOCK_SIZE;
+    block_table = new sym_index[block_size];
+    scope_base = new long[block_size];
+    for (int i = 0; i < block_size; i++) {
         block_table[i] = 0;
+        scope_base[i] = 0;
     }
+    scope_size = BASE_BLOCK_SIZE;
+    scope_top = 0;
+    scope_symbols = new sym_index[scope_size];
 
     // --- Initialize symbol table. ---
-    // Weird syntax, gives us a table of pointers to symbols.
-    sym_table = new symbol*[MAX_SYM];
-    for (int i = 0; i < MAX_SYM; i++) {
-        sym_table[i] = NULL;
+    // Weird syntax, gives us a directory of tables of pointers to symbols.
+    // The first segment is allocated right away, the rest as needed.
+    sym_segments = 1;
+    sym_table = new symbol**[sym_segments];
+    sym_table[0] = new symbol*[SYM_SEGMENT_SIZE];
+    for (int i = 0; i < SYM_SEGMENT_SIZE; i++) {
+        sym_table[0][i] = NULL;
     }
+    // The hot table's rows are filled in as the symbols are installed.
+    hot_table = new symbol_hot*[sym_segments];
+    hot_table[0] = new symbol_hot[SYM_SEGMENT_SIZE];
+    sym_arena = new memory_arena();
+
+    image = NULL;
+    image_length = 0;
 
     label_nr = -1;
     temp_nr = 0;
@@ -79,23 +117,34 @@ symbol_table::symbol_table()
     if (TEST_SCANNER) {
         return;
     }
+    // Loading the image is much cheaper than installing them one by one.
+    if (prelude == NULL || !load_image(prelude)) {
+        install_prelude();
+    }
+}
+
+
+/* Install the predefined symbols by hand. Used when there is no prelude
+   image, and by mkprelude to create it. */
+void symbol_table::install_prelude()
+{
     // This is just a dummy position for the preinstalled functions.
     position_information *dummy_pos = new position_information();
 
     // This "empty" symbol represents the global level.
     enter_procedure(dummy_pos, pool_install(capitalize("global.")));
-    if (0==sym_table[0]) {
+    if (0==sym_slot(0)) {
       throw std::logic_error("Failed to install symbol");
     }
     // Needed since there have been no types installed yet.
-    sym_table[0]->type = void_type;
+    hot_slot(0).type = void_type;
 
     // Install the default nametypes. This is the only place enter_nametype()
     // is used, since currently Diesel's grammar doesn't handle used-defined
     // types.
 
     void_type = enter_nametype(dummy_pos, pool_install(capitalize("void")));
-    sym_table[void_type]->type = void_type; // Needed since it's the first one.
+    hot_slot(void_type).type = void_type; // Needed since it's the first one.
 
     integer_type = enter_nametype(dummy_pos, pool_install(capitalize("integer")));
 
@@ -104,7 +153,7 @@ symbol_table::symbol_table()
     {
         // Add the read() function. It returns an integer and takes no arguments.
         sym_index read_sym = enter_function(dummy_pos, pool_install(capitalize("read")));
-        sym_table[read_sym]->type = integer_type;
+        hot_slot(read_sym).type = integer_type;
     }
     {
         // Add the write(int-arg) procedure. It takes an integer argument.
@@ -116,15 +165,15 @@ symbol_table::symbol_table()
         sym_index int_arg = enter_parameter(dummy_pos,
                                             pool_install(capitalize("int-arg")),
                                             integer_type);
-        procedure_symbol *proc = sym_table[write_sym]->get_procedure_symbol();
-        proc->last_parameter = sym_table[int_arg]->get_parameter_symbol();
+        procedure_symbol *proc = sym_slot(write_sym)->get_procedure_symbol();
+        proc->last_parameter = sym_slot(int_arg)->get_parameter_symbol();
     }
 
     // Add the trunc(real-arg) function. It returns an integer and takes
     // a real argument.
     sym_index trunc_sym = enter_function(dummy_pos, pool_install(capitalize("trunc")));
-    symbol *truc = sym_table[trunc_sym];
-    truc->type = integer_type;
+    symbol *truc = sym_slot(trunc_sym);
+    truc->hot->type = integer_type;
 
     // Get rid of int-arg, which is linked together with real-arg by
     // enter_parameter. This is very handy everywhere in this compiler except
@@ -133,12 +182,350 @@ symbol_table::symbol_table()
                            pool_install(capitalize("real-arg")),
                            real_type);
 
-    parameter_symbol *par = sym_table[real_arg]->get_parameter_symbol();
+    parameter_symbol *par = sym_slot(real_arg)->get_parameter_symbol();
     par->preceding = NULL;
-    par->offset = 0;
+    par->hot->offset = 0;
     truc->get_function_symbol()->last_parameter = par;
 
-    sym_table[0]->get_procedure_symbol()->last_parameter = NULL;
+    sym_slot(0)->get_procedure_symbol()->last_parameter = NULL;
+}
+
+
+/* Destructor. The symbols live in sym_arena, so they are all freed at once
+   when it is deleted. None of the symbol classes need their destructors
+   run. Whatever still lies in a loaded image goes with the mapping. */
+symbol_table::~symbol_table()
+{
+    if (!in_image(string_pool)) {
+        delete[] string_pool;
+    }
+    if (!in_image(intern_table)) {
+        delete[] intern_table;
+        delete[] hash_table;
+        delete[] pool_slots;
+    }
+    delete[] block_table;
+    delete[] scope_base;
+    delete[] scope_symbols;
+    for (long i = 0; i <= sym_pos / SYM_SEGMENT_SIZE; i++) {
+        if (!in_image(sym_table[i])) {
+            delete[] sym_table[i];
+            delete[] hot_table[i];
+        }
+    }
+    delete[] sym_table;
+    delete[] hot_table;
+    delete sym_arena;
+    if (image != NULL) {
+        munmap(image, image_length);
+    }
+}
+
+
+
+/*** Image methods. ***/
+
+/* A symbol table image starts with an image_header. It is followed by the
+   string pool, the intern, hash and pool slot tables, the symbol table
+   segments, the hot table segments and the symbol objects themselves, in
+   that order, each section starting on an 8-byte boundary. It is laid out
+   as if mapped at IMAGE_BASE, so the segments, the symbols' hot pointers
+   and the links between parameters hold real pointers, and load_image()
+   can use all of it where it lies. */
+static const char IMAGE_MAGIC[8] = "DIESIMG";
+
+// Bump this whenever the layout or the hash function changes.
+static const int IMAGE_VERSION = 5;
+
+// The address images are laid out for. Well away from where the program,
+// its heap and the shared libraries go on x86-64 Linux, so the kernel
+// normally grants it as a hint.
+static const uintptr_t IMAGE_BASE = 0x100000000000;
+
+struct image_header {
+    char magic[8];
+    int version;
+    // Catches images written by a compiler with another symbol layout.
+    int symbol_size[SYM_UNDEF];
+    uintptr_t base;
+    long pool_length;
+    long pool_pos;
+    long intern_size;
+    long intern_count;
+    long sym_pos;
+    long symbol_bytes;
+    long temp_nr;
+    int label_nr;
+    sym_index void_type;
+    sym_index integer_type;
+    sym_index real_type;
+};
+
+// Byte offsets of the sections of an image.
+struct image_layout {
+    long pool;
+    long intern;
+    long binding;
+    long slots;
+    long segments;
+    long hot;
+    long symbols;
+    long size;
+};
+
+static long image_align(long n)
+{
+    return (n + 7) & ~7L;
+}
+
+/* The size of the symbol class of a given kind. */
+static int symbol_size(const sym_type kind)
+{
+    switch (kind) {
+    case SYM_CONST:
+        return sizeof(constant_symbol);
+    case SYM_VAR:
+        return sizeof(variable_symbol);
+    case SYM_ARRAY:
+        return sizeof(array_symbol);
+    case SYM_PARAM:
+        return sizeof(parameter_symbol);
+    case SYM_PROC:
+        return sizeof(procedure_symbol);
+    case SYM_FUNC:
+        return sizeof(function_symbol);
+    case SYM_NAMETYPE:
+        return sizeof(nametype_symbol);
+    default:
+        fatal("symbol_size: Bad symbol kind");
+        return 0;
+    }
+}
+
+static image_layout layout_image(const image_header *h)
+{
+    image_layout l;
+    l.pool = image_align(sizeof(image_header));
+    // The whole pool is saved, so that there is room to append to it.
+    l.intern = l.pool + image_align(h->pool_length);
+    l.binding = l.intern + h->intern_size * sizeof(intern_entry);
+    l.slots = image_align(l.binding + h->intern_size * sizeof(sym_index));
+    l.segments = l.slots + h->intern_size * sizeof(pool_slot_entry);
+    long rows = (h->sym_pos / SYM_SEGMENT_SIZE + 1) * SYM_SEGMENT_SIZE;
+    l.hot = l.segments + rows * sizeof(symbol *);
+    l.symbols = l.hot + rows * sizeof(symbol_hot);
+    l.size = l.symbols + h->symbol_bytes;
+    return l;
+}
+
+/* Move a pointer into an image that was mapped delta bytes away from
+   where it was laid out. */
+template <typename T>
+static T *image_rebase(T *p, intptr_t delta)
+{
+    return p == NULL ? NULL : (T *) ((uintptr_t) p + delta);
+}
+
+
+/* Write the symbol table to an image file. */
+bool symbol_table::save_image(const char *filename)
+{
+    if (current_level != 0) {
+        fatal("symbol_table::save_image: Blocks are still open");
+        return false;
+    }
+
+    image_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, IMAGE_MAGIC, sizeof(h.magic));
+    h.version = IMAGE_VERSION;
+    for (int kind = 0; kind < SYM_UNDEF; kind++) {
+        h.symbol_size[kind] = symbol_size((sym_type) kind);
+    }
+    h.base = IMAGE_BASE;
+    h.pool_length = pool_length;
+    h.pool_pos = pool_pos;
+    h.intern_size = intern_size;
+    h.intern_count = intern_count;
+    h.sym_pos = sym_pos;
+    h.temp_nr = temp_nr;
+    h.label_nr = label_nr;
+    h.void_type = void_type;
+    h.integer_type = integer_type;
+    h.real_type = real_type;
+
+    // Where each symbol goes among the symbol objects.
+    long *sym_offset = new long[sym_pos + 1];
+    h.symbol_bytes = 0;
+    for (sym_index i = 0; i <= sym_pos; i++) {
+        sym_offset[i] = h.symbol_bytes;
+        h.symbol_bytes += image_align(symbol_size(sym_slot(i)->kind));
+    }
+
+    // Zeroed, so that the padding doesn't make images differ.
+    image_layout l = layout_image(&h);
+    char *image = new char[l.size]();
+
+    memcpy(image, &h, sizeof(h));
+    memcpy(image + l.pool, string_pool, pool_pos + 1);
+    memcpy(image + l.intern, intern_table, intern_size * sizeof(intern_entry));
+    memcpy(image + l.binding, hash_table, intern_size * sizeof(sym_index));
+    memcpy(image + l.slots, pool_slots,
+           intern_size * sizeof(pool_slot_entry));
+
+    // The segments point at the symbols as they will be once mapped, and
+    // the symbols at their rows of the hot table.
+    symbol **segments = (symbol **) (image + l.segments);
+    symbol_hot *hot = (symbol_hot *) (image + l.hot);
+    for (sym_index i = 0; i <= sym_pos; i++) {
+        segments[i] = (symbol *) (IMAGE_BASE + l.symbols + sym_offset[i]);
+        hot[i] = hot_slot(i);
+    }
+
+    for (sym_index i = 0; i <= sym_pos; i++) {
+        symbol *sym = sym_slot(i);
+        symbol *copy = (symbol *) (image + l.symbols + sym_offset[i]);
+        memcpy(copy, sym, symbol_size(sym->kind));
+        copy->hot = (symbol_hot *) (IMAGE_BASE + l.hot) + i;
+
+        if (sym->kind == SYM_PARAM) {
+            // The preceding parameter was installed shortly before this
+            // one, so look for it backwards.
+            parameter_symbol *par = sym->get_parameter_symbol();
+            parameter_symbol *par_copy = copy->get_parameter_symbol();
+            par_copy->preceding = NULL;
+            for (sym_index j = i - 1; par->preceding != NULL && j >= 0; j--) {
+                if (sym_slot(j) == par->preceding) {
+                    par_copy->preceding = (parameter_symbol *) segments[j];
+                    break;
+                }
+            }
+        } else if (sym->kind == SYM_PROC || sym->kind == SYM_FUNC) {
+            // The parameters are installed right after their procedure.
+            callable_symbol *env = sym->get_callable_symbol();
+            callable_symbol *env_copy = copy->get_callable_symbol();
+            env_copy->last_parameter = NULL;
+            for (sym_index j = i + 1; env->last_parameter != NULL && j <= sym_pos;
+                 j++) {
+                if (sym_slot(j) == env->last_parameter) {
+                    env_copy->last_parameter = (parameter_symbol *) segments[j];
+                    break;
+                }
+            }
+        }
+    }
+    delete[] sym_offset;
+
+    FILE *f = fopen(filename, "wb");
+    bool ok = f != NULL && fwrite(image, 1, l.size, f) == (size_t) l.size;
+    if (f != NULL && fclose(f) != 0) {
+        ok = false;
+    }
+    delete[] image;
+    return ok;
+}
+
+
+/* Fill an empty symbol table from an image file. The file is mapped copy
+   on write and the tables and symbols are used in place: only pages that
+   are later written to get copied, and only what outgrows them is
+   allocated. */
+bool symbol_table::load_image(const char *filename)
+{
+    assert(pool_pos == 0 && sym_pos == NULL_SYM && image == NULL);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(image_header)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap((void *) IMAGE_BASE, st.st_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    char *mapped = (char *) map;
+    const image_header *h = (const image_header *) mapped;
+    bool ok = memcmp(h->magic, IMAGE_MAGIC, sizeof(h->magic)) == 0 &&
+        h->version == IMAGE_VERSION;
+    for (int kind = 0; ok && kind < SYM_UNDEF; kind++) {
+        ok = h->symbol_size[kind] == symbol_size((sym_type) kind);
+    }
+    if (!ok || layout_image(h).size != st.st_size) {
+        munmap(map, st.st_size);
+        return false;
+    }
+    image_layout l = layout_image(h);
+    image = mapped;
+    image_length = st.st_size;
+
+    // If some other image already sits at IMAGE_BASE, move the pointers
+    // along. Otherwise there is nothing to do.
+    symbol **segments = (symbol **) (image + l.segments);
+    symbol_hot *hot = (symbol_hot *) (image + l.hot);
+    intptr_t delta = (intptr_t) ((uintptr_t) image - h->base);
+    if (delta != 0) {
+        for (sym_index i = 0; i <= h->sym_pos; i++) {
+            segments[i] = image_rebase(segments[i], delta);
+        }
+        for (sym_index i = 0; i <= h->sym_pos; i++) {
+            symbol *sym = segments[i];
+            sym->hot = image_rebase(sym->hot, delta);
+            if (sym->kind == SYM_PARAM) {
+                parameter_symbol *par = sym->get_parameter_symbol();
+                par->preceding = image_rebase(par->preceding, delta);
+            } else if (sym->kind == SYM_PROC || sym->kind == SYM_FUNC) {
+                callable_symbol *env = sym->get_callable_symbol();
+                env->last_parameter = image_rebase(env->last_parameter, delta);
+            }
+        }
+    }
+
+    // The string pool.
+    delete[] string_pool;
+    string_pool = image + l.pool;
+    pool_length = h->pool_length;
+    pool_pos = h->pool_pos;
+
+    // The intern, hash and pool slot tables.
+    delete[] intern_table;
+    delete[] hash_table;
+    delete[] pool_slots;
+    intern_size = h->intern_size;
+    intern_count = h->intern_count;
+    intern_table = (intern_entry *) (image + l.intern);
+    hash_table = (sym_index *) (image + l.binding);
+    pool_slots = (pool_slot_entry *) (image + l.slots);
+    last_installed = -1;
+
+    // The symbols and their hot fields. New segments are added after the
+    // image's own.
+    delete[] sym_table[0];
+    delete[] sym_table;
+    delete[] hot_table[0];
+    delete[] hot_table;
+    sym_segments = h->sym_pos / SYM_SEGMENT_SIZE + 1;
+    sym_table = new symbol**[sym_segments];
+    hot_table = new symbol_hot*[sym_segments];
+    for (long i = 0; i < sym_segments; i++) {
+        sym_table[i] = segments + i * SYM_SEGMENT_SIZE;
+        hot_table[i] = hot + i * SYM_SEGMENT_SIZE;
+    }
+    sym_pos = h->sym_pos;
+
+    label_nr = h->label_nr;
+    temp_nr = h->temp_nr;
+    void_type = h->void_type;
+    integer_type = h->integer_type;
+    real_type = h->real_type;
+
+    return true;
 }
 
 
@@ -174,8 +561,47 @@ long symbol_table::get_next_label()
    an error. This method is used for quad generation. */
 sym_index symbol_table::gen_temp_var(sym_index type)
 {
-    /* Your code here */
-    return NULL_SYM;
+    if (type == void_type) {
+        fatal("symbol_table::gen_temp_var: Temporary of void type");
+    }
+    if (++temp_nr > MAX_TEMP_VARS) {
+        fatal("symbol_table::gen_temp_var: Too many temporary variables");
+    }
+
+    // Names are padded with spaces to MAX_TEMP_VAR_LENGTH: "$1      ".
+    char name[MAX_TEMP_VAR_LENGTH + 1];
+    snprintf(name, sizeof(name), "$%-*ld", MAX_TEMP_VAR_LENGTH - 1, temp_nr);
+
+    return enter_variable(pool_install(name), type);
+}
+
+
+/* Add a segment to the symbol and hot tables, doubling the segment
+   directories if they are full. Only the directories are ever copied; the
+   segments, and thus the entries, stay where they are. */
+void symbol_table::grow_sym_table()
+{
+    long segment = (sym_pos + 1) / SYM_SEGMENT_SIZE;
+
+    if (segment == sym_segments) {
+        symbol ***tmp_table = new symbol**[2 * sym_segments];
+        symbol_hot **tmp_hot_table = new symbol_hot*[2 * sym_segments];
+        for (long i = 0; i < sym_segments; i++) {
+            tmp_table[i] = sym_table[i];
+            tmp_hot_table[i] = hot_table[i];
+        }
+        sym_segments *= 2;
+        delete[] sym_table;
+        delete[] hot_table;
+        sym_table = tmp_table;
+        hot_table = tmp_hot_table;
+    }
+
+    sym_table[segment] = new symbol*[SYM_SEGMENT_SIZE];
+    for (int i = 0; i < SYM_SEGMENT_SIZE; i++) {
+        sym_table[segment][i] = NULL;
+    }
+    hot_table[segment] = new symbol_hot[SYM_SEGMENT_SIZE];
 }
 
 
@@ -215,129 +641,161 @@ void symbol_table::print(int detail)
 {
     if (detail == 2) {
         if (pool_pos > 0) {
-            unsigned int pos = 0;
-            while (pos < strlen(string_pool)) {
-                unsigned int len = (int) string_pool[pos];
-                cout << len;
-                for (unsigned int k = pos + 1; k < pos + len + 1; k++) {
-                    cout << string_pool[k];
-                }
-                pos += len + 1;
+            pool_index pos = 0;
+            while (pos < pool_pos) {
+                pool_string entry = pool_view(pos);
+                listing() << entry.length << entry;
+                pos += entry.length + 1;
             }
-            cout << endl;
+            listing() << endl;
 
             // cout << string_pool << endl;
             for (int j = 0; j < pool_pos; j++) {
-                cout << "-";
+                listing() << "-";
             }
-            cout << "^" << " (pool_pos = " << pool_pos << ")" << endl;
+            listing() << "^" << " (pool_pos = " << pool_pos << ")" << endl;
         } else {
-            cout << "(String pool empty)" << endl;
+            listing() << "(String pool empty)" << endl;
         }
         return;
     }
 
     if (detail == 3) {
-        cout << "Hash table:\n";
-        for (int j = 0; j < MAX_HASH; j++) {
-            if (hash_table[j]) {
-                cout << j << ": " << hash_table[j] << endl;
+        listing() << "Hash table:\n";
+        for (long j = 0; j < intern_size; j++) {
+            if (hash_table[j] != NULL_SYM) {
+                listing() << j << ": " << hash_table[j] << endl;
+            }
+        }
+        return;
+    }
+
+    if (detail == 4) {
+        // Count the strings per probe length, ie, how far from their home
+        // slot they ended up in the intern (and hash) table, to show how
+        // well the hash function spreads the identifiers of the whole
+        // program. Longer probes than the histogram are counted in the
+        // last row.
+        const int max_len = 16;
+        long probes[max_len + 1] = { 0 };
+        long mask = intern_size - 1;
+        for (long j = 0; j < intern_size; j++) {
+            if (intern_table[j].pool_p == -1) {
+                continue;
+            }
+            long len = (j - intern_table[j].hash) & mask;
+            probes[len < max_len ? len : max_len]++;
+        }
+
+        listing() << "Probe lengths (" << intern_count << " strings in "
+                  << intern_size << " slots):\n";
+        for (int len = 0; len <= max_len; len++) {
+            if (probes[len] == 0) {
+                continue;
+            }
+            listing() << setw(3) << len << (len == max_len ? "+" : " ") << ": "
+                      << setw(6) << probes[len] << " ";
+            // One star per percent of the strings, rounded up.
+            for (long k = 0; k < (100 * probes[len] + intern_count - 1) / intern_count;
+                 k++) {
+                listing() << "*";
             }
+            listing() << endl;
         }
         return;
     }
 
-    cout << endl << "Symbol table (size = " << sym_pos << "):\n";
+    listing() << endl << "Symbol table (size = " << sym_pos << "):\n";
 
     switch (detail) {
     case 1:
         // Element 0 is the global environment, "program.".
-        cout << "Pos  Name      Lev Hash Back Offs Type "
-             << "     Tag\n";
-        cout << "---------------------------------------"
-             << "--------\n";
+        listing() << "Pos  Name      Lev Hash Back Offs Type "
+                  << "     Tag\n";
+        listing() << "---------------------------------------"
+                  << "--------\n";
         for (int i = 0; i < sym_pos + 1; i++) {
-            symbol *tmp = sym_table[i];
+            symbol *tmp = sym_slot(i);
             if (tmp == NULL) {
-                cout << i << ": " << "NULL" << endl;
+                listing() << i << ": " << "NULL" << endl;
                 continue;
             }
 
-            cout << setw(3) << i << ": ";
-            cout.flags(ios::left);
-            cout << setw(12) << pool_lookup(tmp->id);
-            cout.flags(ios::right);
-            cout << tmp->level
-                 << setw(5) << tmp->hash_link << setw(5)
-                 << tmp->back_link << setw(5) << tmp->offset << " ";
-
-            cout.flags(ios::left);
-            cout << setw(10);
-            cout << pool_lookup(sym_table[tmp->type]->id);
-            cout << setw(14);
-            switch (tmp->tag) {
+            listing() << setw(3) << i << ": ";
+            listing().flags(ios::left);
+            listing() << setw(12) << pool_view(tmp->id);
+            listing().flags(ios::right);
+            listing() << tmp->hot->level
+                      << setw(5) << tmp->hash_link << setw(5)
+                      << tmp->back_link << setw(5) << tmp->hot->offset << " ";
+
+            listing().flags(ios::left);
+            listing() << setw(10);
+            listing() << pool_view(sym_slot(tmp->hot->type)->id);
+            listing() << setw(14);
+            switch (tmp->hot->tag) {
             case SYM_UNDEF:
-                cout << "SYM_UNDEF";
+                listing() << "SYM_UNDEF";
                 break;
             case SYM_NAMETYPE:
-                cout << "SYM_NAMETYPE";
+                listing() << "SYM_NAMETYPE";
                 break;
             case SYM_VAR:
-                cout << "SYM_VAR";
+                listing() << "SYM_VAR";
                 break;
             case SYM_PARAM: {
                 parameter_symbol *par = tmp->get_parameter_symbol();
-                cout << "SYM_PARAM";
+                listing() << "SYM_PARAM";
                 if (par->preceding != NULL) {
-                    cout << setw(7) << "prec = "
-                         << setw(12) <<
-                         pool_lookup(par->preceding->id);
+                    listing() << setw(7) << "prec = "
+                              << setw(12) <<
+                         pool_view(par->preceding->id);
                 }
                 break;
             }
             case SYM_PROC: {
                 procedure_symbol * proc = tmp->get_procedure_symbol();
-                cout << "SYM_PROC" << setw(6) << "lbl = "
-                     << setw(3) << proc->label_nr << setw(9)
-                     << "ar_size = " << setw(3) << proc->ar_size;
+                listing() << "SYM_PROC" << setw(6) << "lbl = "
+                          << setw(3) << proc->label_nr << setw(9)
+                          << "ar_size = " << setw(3) << proc->ar_size;
                 break;
             }
             case SYM_FUNC: {
                 function_symbol *func = tmp->get_function_symbol();
-                cout << "SYM_FUNC" << setw(6) << "lbl = "
-                     << setw(3) << func->label_nr << setw(9)
-                     << "ar_size = " << setw(3) << func->ar_size;
+                listing() << "SYM_FUNC" << setw(6) << "lbl = "
+                          << setw(3) << func->label_nr << setw(9)
+                          << "ar_size = " << setw(3) << func->ar_size;
                 break;
             }
             case SYM_ARRAY: {
                 array_symbol *arr = tmp->get_array_symbol();
-                cout << "SYM_ARRAY" << setw(7) << "card = "
-                     << setw(4) << arr->array_cardinality;
+                listing() << "SYM_ARRAY" << setw(7) << "card = "
+                          << setw(4) << arr->array_cardinality;
                 break;
             }
             case SYM_CONST: {
                 constant_symbol *con = tmp->get_constant_symbol();
-                if (con->type == integer_type)
-                    cout << "SYM_CONST" << setw(7) << "value = "
-                         << con->const_value.ival;
-                else if (con->type == real_type)
-                    cout << "SYM_CONST" << setw(7) << "value = "
-                         << con->const_value.rval;
+                if (con->hot->type == integer_type)
+                    listing() << "SYM_CONST" << setw(7) << "value = "
+                              << con->const_value.ival;
+                else if (con->hot->type == real_type)
+                    listing() << "SYM_CONST" << setw(7) << "value = "
+                              << con->const_value.rval;
                 else
-                    cout << "SYM_CONST" << setw(7) << "value = "
-                         << "(error: bad type)";
+                    listing() << "SYM_CONST" << setw(7) << "value = "
+                              << "(error: bad type)";
                 break;
             }
             }
-            cout.flags(ios::right);
-            cout << setw(0) << endl;
+            listing().flags(ios::right);
+            listing() << setw(0) << endl;
         }
         break;
     default:
         for (int i = 0; i < sym_pos + 1; i++) {
-            symbol *tmp = sym_table[i];
-            cout << "Pos = " << i << " -----------------------------\n"
-                 << tmp;
+            symbol *tmp = sym_slot(i);
+            listing() << "Pos = " << i << " -----------------------------\n"
+                      << tmp;
         }
         break;
     }
@@ -347,6 +805,28 @@ void symbol_table::print(int detail)
 
 /*** String pool methods ***/
 
+/* Print a view of a pool string. The characters are written directly from
+   the pool, padded by hand since ostream::write() ignores setw(). */
+ostream &operator<<(ostream &o, const pool_string &s)
+{
+    streamsize pad = o.width() > s.length ? o.width() - s.length : 0;
+    bool left = (o.flags() & ios::adjustfield) == ios::left;
+    o.width(0);
+
+    if (!left) {
+        for (streamsize i = 0; i < pad; i++) {
+            o.put(o.fill());
+        }
+    }
+    o.write(s.chars, s.length);
+    if (left) {
+        for (streamsize i = 0; i < pad; i++) {
+            o.put(o.fill());
+        }
+    }
+    return o;
+}
+
 /* Convenience method for capitalizing strings. Called by the scanner.
    Note that using this method without deleting the string afterwards causes
    a memory leak. */
@@ -365,6 +845,116 @@ char *symbol_table::capitalize(const char *s)
     return capitalized_s;
 }
 
+/* ASCII-only toupper(), which is all the language needs and saves the
+   locale lookup in the scanner's hot path. */
+static inline unsigned char upcase(char c)
+{
+    return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+}
+
+
+/* Compare a pool entry with a counted string, capitalizing the latter on the
+   fly if upper is true. */
+static bool same_string(const char *entry, const char *s, int len, bool upper)
+{
+    if (!upper) {
+        return memcmp(entry, s, len) == 0;
+    }
+    for (int i = 0; i < len; i++) {
+        if ((unsigned char) entry[i] != upcase(s[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/* Hash a counted string: FNV-1a over the bytes, followed by the murmur3
+   finalizer so that the low bits, which select the bucket, depend on every
+   input byte. Computed once per string when it is installed, and kept in
+   its intern table slot. If upper is true, the hash is that of the capitalized
+   string. */
+static unsigned int hash_string(const char *s, int len, bool upper)
+{
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= upper ? upcase(s[i]) : (unsigned char) s[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+
+/* Return the intern table slot holding the string s of length len and hash
+   value h, or the empty slot where it should go if it isn't in the pool.
+   If upper is true, s is looked up as if capitalized. Uses linear probing;
+   the table is never more than half full, so this terminates. */
+long symbol_table::intern_slot(const char *s, int len, unsigned int h,
+                               bool upper)
+{
+    long mask = intern_size - 1;
+    long slot = h & mask;
+
+    while (intern_table[slot].pool_p != -1) {
+        // Cheap check on the cached hash before looking at the characters.
+        if (intern_table[slot].hash == h) {
+            pool_string entry = pool_view(intern_table[slot].pool_p);
+            if (entry.length == len &&
+                same_string(entry.chars, s, len, upper)) {
+                break;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+/* Double the size of the intern table, reinserting all entries. The hash
+   table entries move along with them, and pool_slots is made anew. */
+void symbol_table::intern_grow()
+{
+    intern_entry *old_table = intern_table;
+    sym_index *old_hash_table = hash_table;
+    long old_size = intern_size;
+
+    intern_size *= 2;
+    intern_table = new intern_entry[intern_size];
+    hash_table = new sym_index[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i].pool_p = -1;
+        hash_table[i] = NULL_SYM;
+    }
+
+    // The entries are known to be distinct, so we only need to find an
+    // empty slot for each.
+    long mask = intern_size - 1;
+    for (long i = 0; i < old_size; i++) {
+        if (old_table[i].pool_p != -1) {
+            long slot = old_table[i].hash & mask;
+            while (intern_table[slot].pool_p != -1) {
+                slot = (slot + 1) & mask;
+            }
+            intern_table[slot] = old_table[i];
+            hash_table[slot] = old_hash_table[i];
+        }
+    }
+    if (!in_image(old_table)) {
+        delete[] old_table;
+        delete[] old_hash_table;
+        delete[] pool_slots;
+    }
+    pool_slots = new pool_slot_entry[intern_size];
+    pool_slots_rebuild();
+    last_installed = -1;
+}
+
+
 /* Install a string into the pool table and return its index.
    The table is on the form <string1 length>string1<string2 length>string2...
    Note that the null char denotes the end of the entire pool,
@@ -373,71 +963,134 @@ char *symbol_table::capitalize(const char *s)
    7INTEGER4REAL4READ5WRITE4PROG1A\0
                   ^
                   pool_pos
+   Each spelling is only stored once. If s is already in the pool, the index
+   of the existing entry is returned and the pool is left untouched.
 */
 
 pool_index symbol_table::pool_install(char *s)
 {
+    return pool_install(s, strlen(s));
+}
+
+
+/* Install the len characters starting at s, which need not be null
+   terminated. The scanner uses this to intern identifiers and strings
+   straight out of its buffer; with upper set the spelling is capitalized as
+   it is copied, so no temporary string is needed. */
+pool_index symbol_table::pool_install(const char *s, int len, bool upper)
+{
+    // This is not really a pretty solution but it works for now. Some sort
+    // struct with length/char * would be a more general solution, since this
+    // way we're limited to strings that fit within 255 bytes.
+    if (len >= 255) {
+        fatal("symbol_table::pool_install: Too long string");
+        return 0;
+    }
+
+    // Already interned?
+    unsigned int h = hash_string(s, len, upper);
+    long slot = intern_slot(s, len, h, upper);
+    if (intern_table[slot].pool_p != -1) {
+        last_installed = intern_table[slot].pool_p;
+        last_installed_slot = slot;
+        return last_installed;
+    }
+
     // Make sure pool is not full. If it is, double pool size.
-    if (pool_pos + 1 + (int) strlen(s) >= pool_length) {
+    if (pool_pos + 1 + len >= pool_length) {
         char *tmp_pool = new char[2 * pool_length];
 
-        // Double pool size.
+        // Double pool size. Copy by length: a zero length byte (from an
+        // empty string constant) would stop strcpy.
+        memcpy(tmp_pool, string_pool, pool_pos + 1);
         pool_length *= 2;
-        strcpy(tmp_pool, string_pool);
-        delete[] string_pool;
+        if (!in_image(string_pool)) {
+            delete[] string_pool;
+        }
         string_pool = tmp_pool;
     }
 
     // The return value, ie, the start of the string.
     long old_pos = pool_pos;
 
-    // This is not really a pretty solution but it works for now. Some sort
-    // struct with length/char * would be a more general solution, since this
-    // way we're limited to strings that fit within 255 bytes.
-    if (strlen(s) >= 255) {
-        fatal("symbol_table::pool_install: Too long string");
-        return 0;
-    }
-
     // First install the length of the string.
-    string_pool[pool_pos++] = (unsigned char) strlen(s);
-    string_pool[pool_pos] = '\0';
+    string_pool[pool_pos++] = (unsigned char) len;
 
     // Add the string itself to the end of the pool.
-    strcpy(string_pool+pool_pos, s);
+    if (upper) {
+        for (int i = 0; i < len; i++) {
+            string_pool[pool_pos + i] = upcase(s[i]);
+        }
+    } else {
+        memcpy(string_pool + pool_pos, s, len);
+    }
 
     // Move pool_pos to the end of the new entry.
-    pool_pos += strlen(s);
+    pool_pos += len;
+    string_pool[pool_pos] = '\0';
+
+    // Remember it, and its hash value, in the intern table, keeping it at
+    // most half full.
+    intern_table[slot].pool_p = old_pos;
+    intern_table[slot].hash = h;
+    pool_slot_insert(slot);
+    last_installed = old_pos;
+    last_installed_slot = slot;
+    if (2 * ++intern_count > intern_size) {
+        intern_grow();
+    }
 
     return old_pos;
 }
 
 
-/* Allocate memory for and return a string given a pool_index. */
+/* Return the number of bytes used in the string pool, length bytes
+   included. */
 
-char *symbol_table::pool_lookup(const pool_index p)
+long symbol_table::pool_used()
+{
+    return pool_pos;
+}
+
+
+/* Return a view of a string given a pool_index. Nothing is allocated; the
+   view points into the pool itself. */
+
+pool_string symbol_table::pool_view(const pool_index p)
 {
     // Catch references to beyond last string.
     assert(p < pool_pos);
 
-    // Start points to first char of the sought string.
-    // We just use it to index the pool, it is never assigned to.
-    char *start = &string_pool[p + 1];
+    pool_string view;
+    // p points to the char holding the length of the sought string. It has
+    // to be read unsigned, since lengths go up to 254.
+    view.length = (unsigned char) string_pool[p];
+    // The sought string starts right after it.
+    view.chars = &string_pool[p + 1];
+
+    return view;
+}
+
 
-    // p points to the char holding the length of the sought string.
-    int length = (int) string_pool[p];
+/* Allocate memory for and return a string given a pool_index. The caller
+   owns the returned string. */
+
+char *symbol_table::pool_lookup(const pool_index p)
+{
+    pool_string view = pool_view(p);
 
     // We only want to return a string of length chars, plus
     // one extra for the null terminator.
-    char *s = new char[length + 1];
-    strncpy(s, start, length);
-    s[length] = '\0';
+    char *s = new char[view.length + 1];
+    memcpy(s, view.chars, view.length);
+    s[view.length] = '\0';
 
     return s;
 }
 
 
-/* Compare two strings. */
+/* Compare two strings. The pool is interned, so equal strings always have
+   the same index. */
 
 bool symbol_table::pool_compare(const pool_index pool_p1,
                                 const pool_index pool_p2)
@@ -445,7 +1098,7 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
     // Catch too large pos.
     assert(pool_p1 < pool_pos && pool_p2 < pool_pos);
 
-    return strcmp(pool_lookup(pool_p1), pool_lookup(pool_p2)) == 0;
+    return pool_p1 == pool_p2;
 }
 
 
@@ -453,10 +1106,39 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
 
 pool_index symbol_table::pool_forget(const pool_index pool_p)
 {
-    char *last_entry = pool_lookup(pool_p);
+    pool_string last_entry = pool_view(pool_p);
 
     // Make sure that this really is the last entry.
-    assert((pool_p + (int) strlen(last_entry)) == pool_pos - 1);
+    assert(pool_p + last_entry.length == pool_pos - 1);
+
+    // Remove it from the intern table. Later entries in the same probe
+    // sequence are shifted back so that lookups still find them. A string
+    // that names a visible symbol can't be forgotten.
+    long mask = intern_size - 1;
+    long hole = binding_slot(pool_p);
+    assert(hash_table[hole] == NULL_SYM);
+    pool_slot_remove(pool_p);
+    last_installed = -1;
+    long slot = hole;
+    intern_table[hole].pool_p = -1;
+    intern_count--;
+    while (true) {
+        slot = (slot + 1) & mask;
+        if (intern_table[slot].pool_p == -1) {
+            break;
+        }
+        long home = intern_table[slot].hash & mask;
+        // Move the entry into the hole unless its home slot lies
+        // cyclically in (hole, slot].
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            pool_slots[pool_slot(intern_table[slot].pool_p)].intern_slot = hole;
+            intern_table[hole] = intern_table[slot];
+            hash_table[hole] = hash_table[slot];
+            intern_table[slot].pool_p = -1;
+            hash_table[slot] = NULL_SYM;
+            hole = slot;
+        }
+    }
 
     // Back up pool_pos one entry.
     pool_pos = pool_p;
@@ -502,22 +1184,107 @@ char *symbol_table::fix_string(const char *old_str)
 
 /*** Hash table methods. ***/
 
-/* Uses the hash_x33 algorithm. Returns an index into the symbol table
-   given a string. The string is probably attained using pool_lookup(). */
+/* Returns the home slot in the hash table given a string: its hash value,
+   cached in its intern table slot when it was installed. */
 hash_index symbol_table::hash(const pool_index p)
 {
-    char *s = pool_lookup(p);
-    int len = (int) strlen(s);
-    // Magical hash value variable.
-    unsigned int h = 0;
-    // Calculate the hash value.
-    while (len > 0) {
-        h = (h << 5) + h + *s++;
-        len--;
+    // Catch references to beyond last string.
+    assert(p < pool_pos);
+
+    return intern_table[binding_slot(p)].hash & (intern_size - 1);
+}
+
+
+/* The home slot of a pool_index in pool_slots. Pool indices are byte
+   offsets, so they are mixed first to spread them over the table. */
+static long pool_slot_home(const pool_index p, const long mask)
+{
+    unsigned long h = (unsigned long) p * 0x9e3779b97f4a7c15UL;
+    return (h ^ (h >> 32)) & mask;
+}
+
+
+/* Return the pool_slots slot that refers to an installed string. */
+long symbol_table::pool_slot(const pool_index p)
+{
+    long mask = intern_size - 1;
+    long slot = pool_slot_home(p, mask);
+
+    while (true) {
+        // Every pool_index handed out by pool_install() is in the table.
+        assert(pool_slots[slot].pool_p != -1);
+        if (pool_slots[slot].pool_p == p) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
     }
-    // Memory leak since s is still allocated. However, since we've
-    // changed it, delete[] s is not a good idea at all.
-    return h % MAX_HASH;
+}
+
+
+/* Add the string in the given intern table slot to pool_slots. */
+void symbol_table::pool_slot_insert(const long intern_slot)
+{
+    long mask = intern_size - 1;
+    pool_index p = intern_table[intern_slot].pool_p;
+    long slot = pool_slot_home(p, mask);
+
+    while (pool_slots[slot].pool_p != -1) {
+        slot = (slot + 1) & mask;
+    }
+    pool_slots[slot].pool_p = p;
+    pool_slots[slot].intern_slot = intern_slot;
+}
+
+
+/* Remove an installed string from pool_slots, shifting later entries of
+   the same probe sequence back, as pool_forget() does in the intern
+   table. */
+void symbol_table::pool_slot_remove(const pool_index p)
+{
+    long mask = intern_size - 1;
+    long hole = pool_slot(p);
+    long slot = hole;
+
+    pool_slots[hole].pool_p = -1;
+    while (true) {
+        slot = (slot + 1) & mask;
+        if (pool_slots[slot].pool_p == -1) {
+            break;
+        }
+        long home = pool_slot_home(pool_slots[slot].pool_p, mask);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            pool_slots[hole] = pool_slots[slot];
+            pool_slots[slot].pool_p = -1;
+            hole = slot;
+        }
+    }
+}
+
+
+/* Fill pool_slots from intern_table, after the latter has grown. */
+void symbol_table::pool_slots_rebuild()
+{
+    for (long i = 0; i < intern_size; i++) {
+        pool_slots[i].pool_p = -1;
+    }
+    for (long i = 0; i < intern_size; i++) {
+        if (intern_table[i].pool_p != -1) {
+            pool_slot_insert(i);
+        }
+    }
+}
+
+
+/* Return the slot of an installed string in the intern and hash tables.
+   It is found through pool_slots, so the string is neither hashed nor
+   looked at again. The parser mostly looks up the name the scanner has
+   just installed, whose slot pool_install() remembers. */
+long symbol_table::binding_slot(const pool_index p)
+{
+    if (p == last_installed) {
+        return last_installed_slot;
+    }
+    return pool_slots[pool_slot(p)].intern_slot;
 }
 
 
@@ -531,30 +1298,58 @@ sym_index symbol_table::current_environment()
 }
 
 
-/* Increase the current_level by one. */
+/* Increase the current_level by one. The block is owned by the symbol
+   installed last, ie, the procedure or function whose body we enter. */
 void symbol_table::open_scope()
 {
-    /* Your code here */
+    // Make sure the block table is not full. If it is, double its size.
+    if (current_level + 1 >= block_size) {
+        sym_index *tmp_table = new sym_index[2 * block_size];
+        long *tmp_base = new long[2 * block_size];
+        for (block_level i = 0; i < block_size; i++) {
+            tmp_table[i] = block_table[i];
+            tmp_base[i] = scope_base[i];
+        }
+        block_size *= 2;
+        delete[] block_table;
+        delete[] scope_base;
+        block_table = tmp_table;
+        scope_base = tmp_base;
+    }
+    block_table[++current_level] = sym_pos;
+    scope_base[current_level] = scope_top;
 }
 
 
-/* Decrease the current_level by one. Return sym_index to new environment. */
+/* Decrease the current_level by one. Return sym_index to new environment.
+   The symbols of the closed block stay in the table, but the declarations
+   they shadowed are put back in the hash table so that lookup_symbol() no
+   longer finds them. */
 sym_index symbol_table::close_scope()
 {
-    /* Your code here */
-    return NULL_SYM;
+    // The symbols of the blocks nested in this one were taken off
+    // scope_symbols when they were closed, so only this block's own are
+    // left on top. Each is the innermost declaration of its name, and
+    // costs one hash table store.
+    while (scope_top > scope_base[current_level]) {
+        symbol *sym = sym_slot(scope_symbols[--scope_top]);
+        hash_table[binding_slot(sym->id)] = sym->hash_link;
+        sym->hash_link = NULL_SYM;
+    }
+
+    current_level--;
+    return current_environment();
 }
 
 
 /*** Main symbol table methods. ***/
 
-/* Return a sym_index to the sought symbol (or 0 if none was found), given
-   a string_pool index. Starts searching in the current block level and
-   follows hash links outwards. */
+/* Return a sym_index to the sought symbol (or NULL_SYM if none was found),
+   given a string_pool index. The hash table always holds the innermost
+   visible declaration of a name, so no links need to be followed. */
 sym_index symbol_table::lookup_symbol(const pool_index pool_p)
 {
-    /* Your code here */
-    return NULL_SYM;
+    return hash_table[binding_slot(pool_p)];
 }
 
 
@@ -566,7 +1361,7 @@ symbol *symbol_table::get_symbol(const sym_index sym_p)
         return NULL;
     }
 
-    return sym_table[sym_p];
+    return sym_slot(sym_p);
 }
 
 
@@ -584,7 +1379,7 @@ pool_index symbol_table::get_symbol_id(const sym_index sym_p)
         return 0;
     }
 
-    return sym_table[sym_p]->id;
+    return sym_slot(sym_p)->id;
 }
 
 
@@ -598,7 +1393,7 @@ sym_index symbol_table::get_symbol_type(const sym_index sym_p)
         return void_type;
     }
 
-    return sym_table[sym_p]->type;
+    return hot_slot(sym_p).type;
 }
 
 
@@ -612,7 +1407,7 @@ sym_type symbol_table::get_symbol_tag(const sym_index sym_p)
         return SYM_UNDEF;
     }
 
-    return sym_table[sym_p]->tag;
+    return hot_slot(sym_p).tag;
 }
 
 
@@ -627,7 +1422,50 @@ void symbol_table::set_symbol_type(const sym_index sym_p,
         return;
     }
 
-    sym_table[sym_p]->type = type_p;
+    hot_slot(sym_p).type = type_p;
+}
+
+
+/* Construct a symbol of the given kind. The symbols are carved out of
+   sym_arena rather than allocated one by one. */
+symbol *symbol_table::new_symbol(const pool_index pool_p, const sym_type kind)
+{
+    symbol *sym;
+    switch (kind) {
+    case SYM_CONST:
+        sym = new (sym_arena->allocate(sizeof(constant_symbol)))
+            constant_symbol(pool_p);
+        break;
+    case SYM_VAR:
+        sym = new (sym_arena->allocate(sizeof(variable_symbol)))
+            variable_symbol(pool_p);
+        break;
+    case SYM_ARRAY:
+        sym = new (sym_arena->allocate(sizeof(array_symbol)))
+            array_symbol(pool_p);
+        break;
+    case SYM_PARAM:
+        sym = new (sym_arena->allocate(sizeof(parameter_symbol)))
+            parameter_symbol(pool_p);
+        break;
+    case SYM_PROC:
+        sym = new (sym_arena->allocate(sizeof(procedure_symbol)))
+            procedure_symbol(pool_p);
+        break;
+    case SYM_FUNC:
+        sym = new (sym_arena->allocate(sizeof(function_symbol)))
+            function_symbol(pool_p);
+        break;
+    case SYM_NAMETYPE:
+        sym = new (sym_arena->allocate(sizeof(nametype_symbol)))
+            nametype_symbol(pool_p);
+        break;
+    default:
+        fatal("symbol_table::new_symbol: Bad symbol kind");
+        return NULL;
+    }
+
+    return sym;
 }
 
 
@@ -643,8 +1481,49 @@ void symbol_table::set_symbol_type(const sym_index sym_p,
 sym_index symbol_table::install_symbol(const pool_index pool_p,
                                        const sym_type tag)
 {
-    /* Your code here */
-    return 0; // Return index to the symbol we just created.
+    long slot = binding_slot(pool_p);
+
+    // Already declared in this block? Then it is the innermost declaration
+    // of the name.
+    sym_index innermost = hash_table[slot];
+    if (innermost != NULL_SYM && hot_slot(innermost).level == current_level) {
+        return innermost;
+    }
+
+    // Start a new segment when the last one is full.
+    if ((sym_pos + 1) % SYM_SEGMENT_SIZE == 0 && sym_pos >= 0) {
+        grow_sym_table();
+    }
+
+    // All symbols are tagged as SYM_UNDEF at creation. This is used later
+    // to check for redeclarations.
+    symbol *sym = new_symbol(pool_p, tag);
+    sym->hot = &hot_slot(sym_pos + 1);
+    sym->hot->tag = SYM_UNDEF;
+    sym->hot->type = void_type;
+    sym->hot->level = current_level;
+    sym->hot->offset = 0;
+
+    // Let it shadow any outer declaration of the same name. The home slot
+    // comes from the hash value cached in the slot found above.
+    sym->back_link = intern_table[slot].hash & (intern_size - 1);
+    sym->hash_link = innermost;
+    sym_slot(++sym_pos) = sym;
+    hash_table[slot] = sym_pos;
+
+    // Remember it for close_scope(), doubling scope_symbols if it is full.
+    if (current_level > 0) {
+        if (scope_top == scope_size) {
+            sym_index *tmp_symbols = new sym_index[2 * scope_size];
+            memcpy(tmp_symbols, scope_symbols, scope_size * sizeof(sym_index));
+            scope_size *= 2;
+            delete[] scope_symbols;
+            scope_symbols = tmp_symbols;
+        }
+        scope_symbols[scope_top++] = sym_pos;
+    }
+
+    return sym_pos; // Return index to the symbol we just created.
 }
 
 /* Enter a constant into the symbol table. The value is an integer. The type
@@ -659,21 +1538,21 @@ sym_index symbol_table::enter_constant(position_information *pos,
 {
     // Install a constant_symbol in the symbol table.
     sym_index sym_p = install_symbol(pool_p, SYM_CONST);
-    constant_symbol *con = sym_table[sym_p]->get_constant_symbol();
+    constant_symbol *con = sym_slot(sym_p)->get_constant_symbol();
 
     // Make sure it's not already been declared.
-    if (con->tag != SYM_UNDEF) {
+    if (con->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << con << endl;
         // returns the first symbol
         return sym_p;
     }
 
     // Set up the constant-specific fields.
-    con->type = type;
-    con->tag = SYM_CONST;
+    con->hot->type = type;
+    con->hot->tag = SYM_CONST;
 
     con->const_value.ival = ival;
-    sym_table[sym_p] = con;
+    sym_slot(sym_p) = con;
 
     return sym_p;
 }
@@ -691,7 +1570,7 @@ sym_index symbol_table::enter_constant(position_information *pos,
 {
     // Install a constant_symbol in the symbol table.
     sym_index sym_p = install_symbol(pool_p, SYM_CONST);
-    constant_symbol *con = sym_table[sym_p]->get_constant_symbol();
+    constant_symbol *con = sym_slot(sym_p)->get_constant_symbol();
 
     // Make sure it's not already been declared.
     // Inside install_symbol, the 'tag' should got the value SYM_UNDEF
@@ -699,7 +1578,7 @@ sym_index symbol_table::enter_constant(position_information *pos,
     // creator).
     // if it happens to has another value, then the symbol already exists
     // and should not be redeclared!
-    if (con->tag != SYM_UNDEF) {
+    if (con->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << con << endl;
         // returns the original symbol
         return sym_p;
@@ -707,11 +1586,11 @@ sym_index symbol_table::enter_constant(position_information *pos,
 
     // Set up the constant-specific fields.
     // set the type to real_type
-    con->type = type;
-    con->tag = SYM_CONST;
+    con->hot->type = type;
+    con->hot->tag = SYM_CONST;
     con->const_value.rval = rval;
 
-    sym_table[sym_p] = con;
+    sym_slot(sym_p) = con;
 
     return sym_p;
 }
@@ -728,7 +1607,7 @@ sym_index symbol_table::enter_variable(position_information *pos,
 
     // This extra mess is required for safe downcasting, so we can access
     // the fields specific to this subclass of symbol.
-    symbol *tmp = sym_table[sym_p];
+    symbol *tmp = sym_slot(sym_p);
     // Without this check, the test program will crash until you have
     // finished your install_symbol method.
     if (tmp == NULL) {
@@ -738,7 +1617,7 @@ sym_index symbol_table::enter_variable(position_information *pos,
     // Make sure it's not already been declared. If it was, then we give a
     // message about this and simply return sym_p. This will cause trouble
     // later, though. NOTE: What to do when this happens?
-    if (tmp->tag != SYM_UNDEF) {
+    if (tmp->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << tmp << endl;
         // returns the original symbol
         return sym_p;
@@ -747,30 +1626,19 @@ sym_index symbol_table::enter_variable(position_information *pos,
     variable_symbol *var = tmp->get_variable_symbol();
 
     // Set up the variable-specific fields.
-    var->type = type;
-    var->tag = SYM_VAR;
+    var->hot->type = type;
+    var->hot->tag = SYM_VAR;
 
     // This information is used later on when we allocate memory space on
     // activation frames. We need to know how many bytes the variable will
     // take up.
 
-    // We re-use tmp for some more casting here. The current block can either
-    // be a function or a procedure, and we need to differ the two. Fortunately
-    // we can use the tag field for this, since it's common to all symbols.
-    tmp = sym_table[current_environment()];
-    if (tmp->tag == SYM_FUNC) {
-        function_symbol *cur_func = tmp->get_function_symbol();
-        var->offset = cur_func->ar_size;
-        cur_func->ar_size += get_size(type);
-        sym_table[current_environment()] = cur_func;
-    } else {
-        procedure_symbol *cur_proc = tmp->get_procedure_symbol();
-        var->offset = cur_proc->ar_size;
-        cur_proc->ar_size += get_size(type);
-        sym_table[current_environment()] = cur_proc;
-    }
-
-    sym_table[sym_p] = var;
+    // The current block can either be a function or a procedure, but they
+    // keep their activation record size in the same place.
+    callable_symbol *cur_env =
+        sym_slot(current_environment())->get_callable_symbol();
+    var->hot->offset = cur_env->ar_size;
+    cur_env->ar_size += get_size(type);
 
     return sym_p;
 }
@@ -798,18 +1666,18 @@ sym_index symbol_table::enter_array(position_information *pos,
 
     // This extra mess is required for safe downcasting, so we can access
     // the fields specific to this subclass of symbol.
-    array_symbol *arr = sym_table[sym_p]->get_array_symbol();
+    array_symbol *arr = sym_slot(sym_p)->get_array_symbol();
 
     // Make sure it's not already been declared.
-    if (arr->tag != SYM_UNDEF) {
+    if (arr->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << arr << endl;
         // returns the original symbol
         return sym_p;
     }
 
     // Set up the array-specific fields.
-    arr->type = type;
-    arr->tag = SYM_ARRAY;
+    arr->hot->type = type;
+    arr->hot->tag = SYM_ARRAY;
     arr->array_cardinality = cardinality;
 
     // This is redundant, really, as the grammar stands currently... It can
@@ -819,10 +1687,9 @@ sym_index symbol_table::enter_array(position_information *pos,
     // This information is used later on when we allocate memory space on
     // activation frames. We need to know how many bytes the variable will
     // take up, and at what offset to find it.
-    // We do some more casting here. The current block can either
-    // be a function or a procedure, and we need to differ the two. Fortunately
-    // we can use the tag field for this, since it's common to all symbols.
-    symbol* tmp = sym_table[current_environment()];
+    // The current block can either be a function or a procedure, but they
+    // keep their activation record size in the same place.
+    symbol* tmp = sym_slot(current_environment());
 
     // We only do this if the array had a legal index. The reason is that the
     // value we use for illegal indexes happens to be -1, and using that value
@@ -832,19 +1699,10 @@ sym_index symbol_table::enter_array(position_information *pos,
     // can't call this method with a float as the last argument, so we take
     // this approach instead.
     if (cardinality != ILLEGAL_ARRAY_CARD) {
-        if (tmp->tag == SYM_FUNC) {
-            function_symbol *cur_func = tmp->get_function_symbol();
-            arr->offset = cur_func->ar_size;
-            cur_func->ar_size += cardinality * get_size(type);
-            sym_table[current_environment()] = cur_func;
-        } else {
-            procedure_symbol *cur_proc = tmp->get_procedure_symbol();
-            arr->offset = cur_proc->ar_size;
-            cur_proc->ar_size += cardinality * get_size(type);
-            sym_table[current_environment()] = cur_proc;
-        }
+        callable_symbol *cur_env = tmp->get_callable_symbol();
+        arr->hot->offset = cur_env->ar_size;
+        cur_env->ar_size += cardinality * get_size(type);
     }
-    sym_table[sym_p] = arr;
 
     return sym_p;
 }
@@ -861,16 +1719,16 @@ sym_index symbol_table::enter_function(position_information *pos,
     // When testing labb2, test nr 3 a function type will be set,
     // but it is done inside the testprogram symtabtest.cc
     sym_index sym_p = install_symbol(pool_p, SYM_FUNC);
-    function_symbol *func = sym_table[sym_p]->get_function_symbol();
+    function_symbol *func = sym_slot(sym_p)->get_function_symbol();
 
     // Make sure it's not already been declared.
-    if (func->tag != SYM_UNDEF) {
+    if (func->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << func << endl;
         return sym_p; // returns the original symbol
     }
 
     // Set up the function-specific fields.
-    func->tag = SYM_FUNC;
+    func->hot->tag = SYM_FUNC;
     // Parameters are added later on.
     func->last_parameter = NULL;
 
@@ -878,7 +1736,7 @@ sym_index symbol_table::enter_function(position_information *pos,
     func->ar_size = 0;
     func->label_nr = get_next_label();
 
-    sym_table[sym_p] = func;
+    sym_slot(sym_p) = func;
 
     return sym_p;
 }
@@ -888,8 +1746,28 @@ sym_index symbol_table::enter_function(position_information *pos,
 sym_index symbol_table::enter_procedure(position_information *pos,
                                         const pool_index pool_p)
 {
-    /* Your code here */
-    return NULL_SYM;
+    // Install a procedure_symbol in the symbol table.
+    sym_index sym_p = install_symbol(pool_p, SYM_PROC);
+    procedure_symbol *proc = sym_slot(sym_p)->get_procedure_symbol();
+
+    // Make sure it's not already been declared.
+    if (proc->hot->tag != SYM_UNDEF) {
+        type_error(pos) << "Redeclaration: " << proc << endl;
+        return sym_p; // returns the original symbol
+    }
+
+    // Set up the procedure-specific fields.
+    proc->hot->tag = SYM_PROC;
+    // Parameters are added later on.
+    proc->last_parameter = NULL;
+
+    // This will grow as local variables and temporaries are added.
+    proc->ar_size = 0;
+    proc->label_nr = get_next_label();
+
+    sym_slot(sym_p) = proc;
+
+    return sym_p;
 }
 
 
@@ -901,10 +1779,10 @@ sym_index symbol_table::enter_parameter(position_information *pos,
 
     // Install a parameter_symbol in the symbol table.
     sym_index sym_p = install_symbol(pool_p, SYM_PARAM);
-    parameter_symbol *par = sym_table[sym_p]->get_parameter_symbol();
+    parameter_symbol *par = sym_slot(sym_p)->get_parameter_symbol();
 
     // Make sure it's not already been declared.
-    if (par->tag != SYM_UNDEF) {
+    if (par->hot->tag != SYM_UNDEF) {
         type_error(pos) << "Redeclaration: " << par << endl;
         // returns the original symbol
         return sym_p;
@@ -920,18 +1798,14 @@ sym_index symbol_table::enter_parameter(position_information *pos,
     // call enter_parameter. So the current_environment() is the new function
     // or procedure, not the one from which it's being called. If this part
     // is confusing, don't be afraid to ask someone. :)
-    symbol *tmp = sym_table[current_environment()];
+    symbol *tmp = sym_slot(current_environment());
 
     parameter_symbol *tmp_param;
 
-    if (tmp->tag == SYM_FUNC) {
-        function_symbol *func = tmp->get_function_symbol();
-        tmp_param = func->last_parameter; // This is the old last parameter.
-        func->last_parameter = par;       // Make 'par' the new last parameter.
-    } else if (tmp->tag == SYM_PROC) {
-        procedure_symbol *proc = tmp->get_procedure_symbol();
-        tmp_param = proc->last_parameter; // This is the old last parameter.
-        proc->last_parameter = par;       // Make 'par' the new last parameter.
+    if (tmp->hot->tag == SYM_FUNC || tmp->hot->tag == SYM_PROC) {
+        callable_symbol *env = tmp->get_callable_symbol();
+        tmp_param = env->last_parameter; // This is the old last parameter.
+        env->last_parameter = par;       // Make 'par' the new last parameter.
     } else {
         fatal("Compiler confused about scope, aborting.");
         return 0;
@@ -950,12 +1824,12 @@ sym_index symbol_table::enter_parameter(position_information *pos,
     }
 
     // Set up the parameter-specific fields.
-    par->offset = param_offset;
-    par->tag = SYM_PARAM;
+    par->hot->offset = param_offset;
+    par->hot->tag = SYM_PARAM;
     par->size = get_size(type);
-    par->type = type;
+    par->hot->type = type;
 
-    sym_table[sym_p] = par;
+    sym_slot(sym_p) = par;
 
     return sym_p;
 }
@@ -973,13 +1847,13 @@ sym_index symbol_table::enter_nametype(position_information *pos,
     sym_index sym_p = install_symbol(pool_p, SYM_NAMETYPE);
 
     // Make sure it's not already been declared.
-    if (sym_table[sym_p]->tag != SYM_UNDEF) {
-        type_error(pos) << "Redeclaration: " << sym_table[sym_p] << endl;
+    if (hot_slot(sym_p).tag != SYM_UNDEF) {
+        type_error(pos) << "Redeclaration: " << sym_slot(sym_p) << endl;
     }
 
     // Set up the nametype-specific fields.
-    sym_table[sym_p]->tag = SYM_NAMETYPE;
-    sym_table[sym_p]->type = void_type;
+    hot_slot(sym_p).tag = SYM_NAMETYPE;
+    hot_slot(sym_p).type = void_type;
 
     return sym_p;
 }
@@ -2,6 +2,7 @@
 #define __SYMTAB_HH__
 
 #include "error.hh"
+#include "arena.hh"
 
 // Set this #define to 0 after the scanner works.
 #if defined(LAB1)
@@ -38,17 +39,41 @@ enum symbol_types {
 };
 typedef enum symbol_types sym_type;
 
-/* Some numerical constants we use in the symbol table. */
+/*! \brief A view of one string pool entry.
 
-/*!
- *  Max allowed nesting levels (size of block table).
+  Points straight into the string pool, so it is only valid until the next
+  string is installed (the pool may be reallocated when it grows). The
+  characters are not null terminated; use ``length``.
  */
-const block_level MAX_BLOCK = 8;
+struct pool_string {
+    const char *chars;
+    int length;
+};
+
+/* Allow a pool_string to be sent to an outstream. Honours setw(). */
+ostream &operator<<(ostream &, const pool_string &);
+
+/* A slot of the symbol table's intern table: a pool entry, and the hash
+   value of its string, computed once when the string was installed. */
+struct intern_entry {
+    pool_index pool_p;
+    unsigned int hash;
+};
+
+/* A slot of the symbol table's pool_slots: a pool entry, and the intern
+   table slot its string is in. */
+struct pool_slot_entry {
+    pool_index pool_p;
+    long intern_slot;
+};
+
+/* Some numerical constants we use in the symbol table. */
 
 /*!
- *  Max size of hash table.
+ *  Base size of block table. It doubles whenever blocks are nested deeper,
+ *  so there is no limit on the nesting depth.
  */
-const hash_index MAX_HASH = 512;
+const block_level BASE_BLOCK_SIZE = 8;
 
 /*!
  *  Base size of string pool.
@@ -56,9 +81,26 @@ const hash_index MAX_HASH = 512;
 const pool_index BASE_POOL_SIZE = 1024;
 
 /*!
- *  Max size of symbol table.
+ *  Base size of the string pool's intern table, which is also the hash
+ *  table for symbols. Must be a power of two.
+ */
+const pool_index BASE_INTERN_SIZE = 256;
+
+/*!
+ *  Size of each segment of the symbol table. The table grows one segment at
+ *  a time, so it has no upper limit and entries never move.
+ */
+const sym_index SYM_SEGMENT_SIZE = 1024;
+
+/*!
+ *  The symbol table image holding the predefined symbols. It is generated
+ *  at build time by mkprelude, and the Makefile sets it to its absolute
+ *  path. If it is not set, or the image can't be loaded, the predefined
+ *  symbols are installed by hand.
  */
-const sym_index MAX_SYM = 1024;
+#ifndef PRELUDE_IMAGE
+#define PRELUDE_IMAGE NULL
+#endif
 
 /*!
  *  Signifies 'no symbol'.
@@ -84,12 +126,56 @@ class constant_symbol;
 class variable_symbol;
 class array_symbol;
 class parameter_symbol;
+class callable_symbol;
 class procedure_symbol;
 class function_symbol;
 class nametype_symbol;
 
 class symbol_table;
 
+
+/*! \brief The fields of a symbol that are read the most.
+
+  Type checking and code generation mostly look at the tag, type, level
+  and offset of symbols. They are kept apart from the symbol objects, in
+  rows of the symbol table's hot table, one per symbol in ``::sym_index``
+  order, so reading them only touches that dense table. A symbol reaches
+  its own row through ``symbol::hot``; code that has a ``::sym_index`` can
+  use ``symbol_table::get_symbol_hot()`` and leave the symbol object alone.
+ */
+struct symbol_hot {
+    /*!
+     This field is only used to give us a way to differentiate between
+     the various symbol classes when we need to do a safe downcast from
+     the superclass. The default value of tag is ``::SYM_UNDEF``, and it
+     is set when the symbol has been declared.
+     */
+    sym_type tag;
+
+    /*! The lexical level states how deeply nested the object is in the program.
+     * For example, an object on the first level is global.
+     * There is no maximum nesting depth.
+     */
+    block_level level;
+
+    /*!
+     Offset specifies which relative position the object has in the
+     memory space which has been reserved for a given lexical level on
+     the runtime stack.
+     This is used during code generation.
+     */
+    int offset;
+
+    /*!
+     In practice type is used only by constants, variables, arrays,
+     parameters and functions; all other symbol types are of type void.
+     The type field contains an index to a name type which in DIESEL
+     only can be ``::integer_type``, ``::real_type``, or ``::void_type``.
+     These will be preinstalled in the symbol table.
+     */
+    sym_index type;
+};
+
 /*! \brief A global pointer to the ::symbol_table.
 
  You will use functions in the ::symbol_table to install strings
@@ -97,16 +183,16 @@ class symbol_table;
  to reduce memory requirements, to look-up and identify symbols,
  as well as forget strings).
  */
-extern symbol_table *sym_tab; // implementation in symtab.cc
+extern thread_local symbol_table *sym_tab; // implementation in symtab.cc
 
 
 
 /* Global symbol table variables. These indexes point to symbols in the symbol
    table which represent information about types. Declared "for real" in
    symbol.cc. */
-extern sym_index void_type;
-extern sym_index integer_type;
-extern sym_index real_type;
+extern thread_local sym_index void_type;
+extern thread_local sym_index integer_type;
+extern thread_local sym_index real_type;
 
 
 
@@ -117,13 +203,18 @@ extern sym_index real_type;
 
 /*! The symbol table consists of entries of subclasses to symbol. This class
    contains data that are common to all symbol types.
-   This class is never used directly. Use the derived classes instead. */
+   This class is never used directly. Use the derived classes instead.
+
+   There are no virtual methods, so symbols carry no vtable pointer. The
+   subclass a symbol was created as is recorded in ``kind``, which both the
+   downcasts and printing switch on. */
 class symbol
 {
 protected:
-    // Every symbol must define a print method, which is called when the
-    // symbol is sent to an outstream.
-    virtual void print(ostream &);
+    // Prints the information common to all symbols. The subclasses each
+    // have a print method that adds their own; operator<< picks the right
+    // one by looking at kind.
+    void print(ostream &);
 
     // This is used later on to control the level of detail given when printing
     // a symbol. If you're not used to C++, don't worry: You don't really need
@@ -138,7 +229,7 @@ protected:
 
     typedef enum format_types format_type;
 
-    static format_type output_format;
+    static thread_local format_type output_format;
 
 public:
     /*! \brief Index to the string_pool, ie, its name.
@@ -160,90 +251,54 @@ public:
     pool_index id;
 
     /*!
-     This field is only used to give us a way to differentiate between
-     the various symbol classes when we need to do a safe downcast from
-     the superclass. The default value of tag is ``::SYM_UNDEF``.
+     The subclass the symbol was created as. Unlike the tag, it is set by
+     the constructor, so a fresh symbol can be downcast before it is
+     declared.
      */
-    sym_type tag;
+    sym_type kind;
 
     /*!
-     In practice type is used only by constants, variables, arrays,
-     parameters and functions; all other symbol types are of type void.
-     The type field contains an index to a name type which in DIESEL
-     only can be ``::integer_type``, ``::real_type``, or ``::void_type``.
-     These will be preinstalled in the symbol table.
+     The tag, type, level and offset of the symbol, in its row of the
+     symbol table's hot table. See ``::symbol_hot``.
      */
-    sym_index type;
+    symbol_hot *hot;
 
     /*!
-     If the object you are searching for not is found immediately after
-     the key transformation, you follow the hash link backwards in the table.
+     The hash table only points to the innermost declaration of every name.
+     The hash link points to the declaration of the same name that this one
+     shadows, if any, and is put back into the hash table when the block
+     is closed.
      */
     sym_index hash_link;
 
     /*!
-     This link points back to the hash table from the symbol table and
-     can be used to speed up certain types of lookups.
-     It is possible to complete the lab without using it, though.
+     This link points back to the hash table from the symbol table, ie,
+     it is the key transformation of the name when the symbol was
+     installed. The table grows, so it is only a hint.
      */
     hash_index back_link;
 
-    /*! The lexical level states how deeply nested the object is in the program.
-     * For example, an object on the first level is global.
-     * Eight levels is the maximum in Diesel.
-     */
-    block_level level;
+    // Constructor. Args: identifier, kind.
+    symbol(pool_index, sym_type);
 
-    /*!
-     Offset specifies which relative position the object has in the
-     memory space which has been reserved for a given lexical level on
-     the runtime stack.
-     This is used during code generation.
-     */
-    int offset;
-
-    // Constructor.
-    symbol(pool_index);
-
-    // Currently lacks print method/operator.
     // Currently lacks some other needed stuff like conversions to and
     //   from strings.
 
-    // These functions must be defined by the appropriate subclasses to
-    // return a symbol of the correct type. This is to be able to ensure
-    // safe downcasts in C++, since we don't want to rely on RTTI information
-    // which isn't as of yet supported in all compilers.
-    // Calling the method in this class is considered an error and will cause
-    // the compiler to abort. It should only be called in a derived class.
-    // The "return NULL;" lines are just there to avoid compiler warnings.
-    virtual constant_symbol *get_constant_symbol() {
-        fatal("Illegal downcasting to constant from symbol class");
-        return NULL;
-    }
-    virtual variable_symbol *get_variable_symbol() {
-        fatal("Illegal downcasting to variable from symbol class");
-        return NULL;
-    }
-    virtual array_symbol *get_array_symbol() {
-        fatal("Illegal downcasting to array from symbol class");
-        return NULL;
-    }
-    virtual parameter_symbol *get_parameter_symbol() {
-        fatal("Illegal downcasting to parameter from symbol class");
-        return NULL;
-    }
-    virtual procedure_symbol *get_procedure_symbol() {
-        fatal("Illegal downcasting to procedure from symbol class");
-        return NULL;
-    }
-    virtual function_symbol *get_function_symbol() {
-        fatal("Illegal downcasting to function from symbol class");
-        return NULL;
-    }
-    virtual nametype_symbol *get_nametype_symbol() {
-        fatal("Illegal downcasting to nametype from symbol class");
-        return NULL;
-    }
+    // These functions return the symbol as the correct subclass. This is to
+    // be able to ensure safe downcasts in C++, since we don't want to rely
+    // on RTTI information. They check kind and are inlined (see the end of
+    // this file), so a downcast costs a compare instead of a virtual call.
+    // Downcasting to the wrong subclass will cause the compiler to abort.
+    constant_symbol *get_constant_symbol();
+    variable_symbol *get_variable_symbol();
+    array_symbol *get_array_symbol();
+    parameter_symbol *get_parameter_symbol();
+    // Procedures and functions share their layout, so a symbol of either
+    // kind can be handled as a callable_symbol.
+    callable_symbol *get_callable_symbol();
+    procedure_symbol *get_procedure_symbol();
+    function_symbol *get_function_symbol();
+    nametype_symbol *get_nametype_symbol();
 
     // Allow us to print a symbol by sending it to an outstream.
     friend ostream &operator<<(ostream &, symbol *);
@@ -254,7 +309,9 @@ public:
 class constant_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
     /*!
@@ -268,10 +325,6 @@ public:
     // Constructor. Arguments: Identifier.
     constant_symbol(const pool_index);
 
-    // Used to be able to safely downcast from symbol to constant_symbol.
-    virtual constant_symbol *get_constant_symbol() {
-        return this;
-    }
 };
 
 
@@ -279,16 +332,14 @@ public:
 class variable_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
     // Constructor. Args: identifier.
     variable_symbol(const pool_index);
 
-    // Used to be able to safely downcast from symbol to variable_symbol.
-    virtual variable_symbol *get_variable_symbol() {
-        return this;
-    }
 };
 
 
@@ -311,7 +362,9 @@ present can only point to the name type ``#integer_type``.
 class array_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
     //! Points to the index type in the symbol table.
@@ -323,10 +376,6 @@ public:
     // Constructor. Args: identifier.
     array_symbol(const pool_index);
 
-    // Used to be able to safely downcast from symbol to array_symbol.
-    virtual array_symbol *get_array_symbol() {
-        return this;
-    }
 };
 
 
@@ -376,7 +425,9 @@ you have that sequence clear, getting them to work will be a lot easier.
 class parameter_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
     //! Nr of bytes parameter needs.
@@ -388,18 +439,21 @@ public:
     // Constructor. Args: identifier.
     parameter_symbol(const pool_index);
 
-    // Used to be able to safely downcast from symbol to parameter_symbol.
-    virtual parameter_symbol *get_parameter_symbol() {
-        return this;
-    }
 };
 
 
-/*! Derived symbol type, used for procedures. */
-class procedure_symbol: public symbol
+/*! \brief Derived symbol type, used for procedures and functions.
+
+  The two only differ in that a function has a return type (the type
+  field), so they share this layout. Code that doesn't care which one it
+  has, like the offset calculations for locals, uses get_callable_symbol().
+ */
+class callable_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
     /*! \brief Activation record size.
@@ -420,48 +474,26 @@ public:
      */
     parameter_symbol *last_parameter;
 
+    // Constructor. Args: identifier, kind.
+    callable_symbol(const pool_index, const sym_type);
+};
+
+
+/*! Derived symbol type, used for procedures. */
+class procedure_symbol: public callable_symbol
+{
+public:
     // Constructor. Args: identifier.
     procedure_symbol(const pool_index);
-
-    // Used to be able to safely downcast from symbol to procedure_symbol.
-    virtual procedure_symbol *get_procedure_symbol() {
-        return this;
-    }
 };
 
 
 /*! Derived symbol type, used for functions. */
-class function_symbol: public symbol
+class function_symbol: public callable_symbol
 {
-protected:
-    virtual void print(ostream &);
-
 public:
-    /*! \brief Activation record size.
-     *
-     * Specifies the memory space that is needed to store the local
-     * variables belonging to the procedure/function on the runtime stack.
-     * A procedure that declares an array of ten integers, two reals and
-     * three integers requires (10+2+3)*8 bytes.
-     */
-    int ar_size;
-
-    //! The label number which is assigned to the procedure or function in assembler code.
-    int label_nr;
-
-    /*!
-       List of parameters. We store them in reverse order to make type-checking
-       easier later on.
-     */
-    parameter_symbol *last_parameter;
-
     // Constructor. Args: identifier.
     function_symbol(const pool_index);
-
-    // Used to be able to safely downcast from symbol to function_symbol.
-    virtual function_symbol *get_function_symbol() {
-        return this;
-    }
 };
 
 
@@ -473,17 +505,15 @@ public:
 class nametype_symbol: public symbol
 {
 protected:
-    virtual void print(ostream &);
+    void print(ostream &);
+
+    friend ostream &operator<<(ostream &, symbol *);
 
 public:
 
     // Constructor. Args: identifier.
     nametype_symbol(const pool_index);
 
-    // Used to be able to safely downcast from symbol to nametype_symbol.
-    virtual nametype_symbol *get_nametype_symbol() {
-        return this;
-    }
 };
 
 
@@ -501,6 +531,81 @@ ostream &long_symbols(ostream &);
 ostream &operator<<(ostream &, symbol *);
 
 
+/* The downcasts. The "return NULL;" lines are just there to avoid compiler
+   warnings. */
+inline constant_symbol *symbol::get_constant_symbol()
+{
+    if (kind != SYM_CONST) {
+        fatal("Illegal downcasting to constant from symbol class");
+        return NULL;
+    }
+    return static_cast<constant_symbol *>(this);
+}
+
+inline variable_symbol *symbol::get_variable_symbol()
+{
+    if (kind != SYM_VAR) {
+        fatal("Illegal downcasting to variable from symbol class");
+        return NULL;
+    }
+    return static_cast<variable_symbol *>(this);
+}
+
+inline array_symbol *symbol::get_array_symbol()
+{
+    if (kind != SYM_ARRAY) {
+        fatal("Illegal downcasting to array from symbol class");
+        return NULL;
+    }
+    return static_cast<array_symbol *>(this);
+}
+
+inline parameter_symbol *symbol::get_parameter_symbol()
+{
+    if (kind != SYM_PARAM) {
+        fatal("Illegal downcasting to parameter from symbol class");
+        return NULL;
+    }
+    return static_cast<parameter_symbol *>(this);
+}
+
+inline callable_symbol *symbol::get_callable_symbol()
+{
+    if (kind != SYM_PROC && kind != SYM_FUNC) {
+        fatal("Illegal downcasting to callable from symbol class");
+        return NULL;
+    }
+    return static_cast<callable_symbol *>(this);
+}
+
+inline procedure_symbol *symbol::get_procedure_symbol()
+{
+    if (kind != SYM_PROC) {
+        fatal("Illegal downcasting to procedure from symbol class");
+        return NULL;
+    }
+    return static_cast<procedure_symbol *>(this);
+}
+
+inline function_symbol *symbol::get_function_symbol()
+{
+    if (kind != SYM_FUNC) {
+        fatal("Illegal downcasting to function from symbol class");
+        return NULL;
+    }
+    return static_cast<function_symbol *>(this);
+}
+
+inline nametype_symbol *symbol::get_nametype_symbol()
+{
+    if (kind != SYM_NAMETYPE) {
+        fatal("Illegal downcasting to nametype from symbol class");
+        return NULL;
+    }
+    return static_cast<nametype_symbol *>(this);
+}
+
+
 
 
 /******************************
@@ -536,11 +641,62 @@ private:
     // Points to end of string pool
     long pool_pos;
 
+    // --- Intern table variables. ---
+
+    /* Open addressed table holding every distinct string in the pool, so
+       each spelling is only stored once. Empty slots have a pool_p of -1.
+       The size is always a power of two. */
+    intern_entry *intern_table;
+
+    // Keep track of dynamic intern table size and number of entries.
+    long intern_size;
+    long intern_count;
+
+    // Find the intern table slot for a string with a given hash value, or
+    // the empty slot where it belongs. Optionally folds the string to upper
+    // case first.
+    long intern_slot(const char *, int, unsigned int, bool);
+
+    // Double the intern table and reinsert every entry.
+    void intern_grow();
+
+    /* Finds the intern table slot of an installed string from its
+       pool_index alone, without looking at the characters. Open addressed
+       and keyed by the pool_index itself, which each entry holds along
+       with the intern table slot, so probing stays within this table.
+       Empty entries have pool_p -1. It has as many slots as
+       intern_table. */
+    pool_slot_entry *pool_slots;
+
+    // The string pool_install() last returned, and its intern table slot,
+    // or -1 if that slot may have changed since.
+    pool_index last_installed;
+    long last_installed_slot;
+
+    // The pool_slots slot referring to an installed string.
+    long pool_slot(const pool_index);
+
+    // Add the string in an intern table slot to pool_slots.
+    void pool_slot_insert(const long);
+
+    // Remove an installed string from pool_slots.
+    void pool_slot_remove(const pool_index);
+
+    // Fill pool_slots anew from intern_table.
+    void pool_slots_rebuild();
+
     // --- Hash table variables. ---
 
-    // The actual hash table.
+    /* The actual hash table. It is parallel to intern_table: each slot
+       holds the innermost visible symbol named by the string in the same
+       intern table slot, or NULL_SYM. Since names are interned, there is
+       at most one chain per name, and it only holds the declarations that
+       shadow each other. */
     sym_index *hash_table;
 
+    // Find the slot of an installed string in the intern and hash tables.
+    long binding_slot(const pool_index);
+
     // --- Display variables. ---
 
     block_level current_level; /*!< \brief Current nesting depth. */
@@ -551,10 +707,69 @@ private:
      */
     sym_index *block_table;
 
+    // Keep track of dynamic block table size.
+    block_level block_size;
+
+    /* The symbols declared in the open blocks, innermost block last, so
+       that close_scope() only visits those of the block it closes. The
+       global level is never closed, so its symbols aren't kept here.
+       scope_base is parallel to block_table: where each block's symbols
+       start. */
+    sym_index *scope_symbols;
+    long scope_size;
+    long scope_top;
+    long *scope_base;
+
     // --- Symbol table variables. ---
 
-    // The actual symbol table.
-    symbol **sym_table;
+    /* The actual symbol table. A directory of segments, each holding
+       SYM_SEGMENT_SIZE symbol pointers. Use sym_slot() to index it. */
+    symbol ***sym_table;
+
+    // Keep track of dynamic directory size.
+    long sym_segments;
+
+    /* The symbol objects themselves are carved out of this arena, so they
+       lie close together in memory and are all freed with the table. */
+    memory_arena *sym_arena;
+
+    // Returns the symbol table entry for a given index.
+    symbol *&sym_slot(const sym_index sym_p) {
+        return sym_table[sym_p / SYM_SEGMENT_SIZE][sym_p % SYM_SEGMENT_SIZE];
+    }
+
+    /* The hot fields of the symbols, see symbol_hot. A directory of
+       segments parallel to sym_table, each holding SYM_SEGMENT_SIZE rows.
+       It has sym_segments entries too. Use hot_slot() to index it. */
+    symbol_hot **hot_table;
+
+    // Returns the row of hot fields for a given index.
+    symbol_hot &hot_slot(const sym_index sym_p) {
+        return hot_table[sym_p / SYM_SEGMENT_SIZE][sym_p % SYM_SEGMENT_SIZE];
+    }
+
+    // Add another segment to the symbol and hot tables.
+    void grow_sym_table();
+
+    // Construct a symbol of the given kind in sym_arena.
+    symbol *new_symbol(const pool_index, const sym_type);
+
+    // Install the predefined symbols by hand.
+    void install_prelude();
+
+    // --- Image variables. ---
+
+    /* The image load_image() mapped in, or NULL. The string pool, the
+       intern and hash tables, the first symbol and hot table segments and
+       the predefined symbols all lie in it until they outgrow it. */
+    char *image;
+    long image_length;
+
+    // Whether p lies in the mapped image, and so mustn't be deleted.
+    bool in_image(const void *p) {
+        return image != NULL && (const char *) p >= image &&
+            (const char *) p < image + image_length;
+    }
 
     // Points to last symbol entered in the table.
     sym_index sym_pos;
@@ -568,7 +783,31 @@ private:
 public:
     // NOTE: Some of these methods should be made private.
 
-    symbol_table();
+    // Constructor. The predefined symbols are loaded from the given
+    // image if possible, otherwise they are installed by hand.
+    symbol_table(const char *prelude = PRELUDE_IMAGE);
+
+    // Frees the tables, the string pool and every symbol.
+    ~symbol_table();
+
+    // --- Image methods. ---
+
+    /*!
+      Writes the string pool and all symbols to an image file that
+      load_image() can map back in, eg, the predefined symbols or a
+      library of global declarations. Only the global level may be open.
+      Returns false if the file can't be written.
+     */
+    bool save_image(const char *);
+
+    /*!
+      Replaces the contents of an empty symbol table with those of an
+      image written by save_image(). The file is mapped copy on write
+      and used in place, so loading costs no more than the mapping.
+      Returns false, leaving the table untouched, if the file is missing
+      or isn't a compatible image.
+     */
+    bool load_image(const char *);
 
     // --- Utility methods. ---
 
@@ -582,30 +821,51 @@ public:
 
     /*!
      Install a string (an identifier or a string constant) in the
-     string pool. Returns the index to the installed string.
+     string pool. Returns the index to the installed string. Strings are
+     interned: installing a spelling that is already in the pool returns
+     the index of the existing entry instead of adding a new one.
      */
     pool_index pool_install(char *);
 
+    /*!
+     Install a string given as a pointer and a length, eg, straight out of
+     the scanner's buffer, which doesn't have to be null terminated. If the
+     last argument is true, the string is capitalized on the way into the
+     pool, like capitalize() but without a temporary copy.
+     */
+    pool_index pool_install(const char *, int, bool upper = false);
+
     /*!
      Given a ``::pool_index`` into the string pool, returns the string it
      points to.
      */
     char *pool_lookup(const pool_index);
 
+    /*!
+     Given a ``::pool_index`` into the string pool, returns a view of the
+     string it points to without copying it. Prefer this to
+     ``symbol_table::pool_lookup``, which allocates a new string that the
+     caller has to delete.
+     */
+    pool_string pool_view(const pool_index);
+
     /*!
      Compare two strings taking their respective ``::pool_index`` as arguments.
-     Returns true if they are identical, and false otherwise. Note that
-     it is not enough to just check that the indices are identical. Why
-     not?
+     Returns true if they are identical, and false otherwise. Since the pool
+     is interned, two strings are identical exactly when their indices are,
+     so this is an integer compare.
      */
     bool pool_compare(const pool_index, const pool_index);
 
     /*!
-     Remove last installed entry from the string pool. This will only
-     be useful if you opt to implement shared strings.
+     Remove last installed entry from the string pool, including its
+     intern table entry.
      */
     pool_index pool_forget(const pool_index);
 
+    //! Returns the number of bytes of the string pool in use.
+    long pool_used();
+
     /*! \brief Remove double ``''`` in strings constants.
 
       Internalizes a string constant. You hopefully use this method in
@@ -628,6 +888,11 @@ public:
 
     symbol *get_symbol(const sym_index);
 
+    /*! Given a symbol table index, returns the symbol's row of hot fields
+      (see ``::symbol_hot``) without looking at the symbol object, or NULL
+      for ``::NULL_SYM``. */
+    symbol_hot *get_symbol_hot(const sym_index);
+
     /*! \brief Installs a symbol in the symbol table and returns its index.
       This method installs a symbol in the symbol table and returns its
       index. If the symbol already existed at the same lexical level
@@ -693,6 +958,10 @@ public:
      3
         Print (only) the non-zero elements in the hash table.
 
+     4
+        Print (only) a histogram of the hash chain lengths, counting the
+        symbols of closed blocks as well.
+
      any other
         Print detailed information about every symbol in the symbol table.
         Watch out, though: this gets very long if you have more than a few symbols installed.
@@ -877,4 +1146,17 @@ public:
 };
 
 
+/* Given a sym_index, return the symbol's row of hot fields. It is used for
+   most references to symbols, so it is inlined, and reading the fields
+   this way doesn't touch the symbol object. */
+inline symbol_hot *symbol_table::get_symbol_hot(const sym_index sym_p)
+{
+    if (sym_p == NULL_SYM) {
+        return NULL;
+    }
+
+    return &hot_slot(sym_p);
+}
+
+
 #endif
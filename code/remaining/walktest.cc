@@ -0,0 +1,274 @@
+#include <iostream>
+#include <vector>
+#include <streambuf>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "ast.hh"
+#include "quads.hh"
+
+using namespace std;
+
+// Tests binary_walk, and the passes and printing built on it. Random
+// expressions are walked and compared with a recursive walk, and then very
+// deep expressions are type checked, optimized, turned into quads and
+// printed on a thread with a small stack, where recursing over them would
+// overflow it. Run it with 'make walk'.
+
+// The flags main.cc would set. The passes look at some of them.
+thread_local bool typecheck = true;
+thread_local bool print_ast = false;
+thread_local bool optimize = true;
+thread_local bool quads = true;
+thread_local bool print_quads = false;
+thread_local bool assembler = false;
+thread_local bool assembler_trace = false;
+
+// The stack the deep expressions are handled on.
+static const size_t SMALL_STACK = 512 * 1024;
+
+// How deep the deep expressions are. Printing one takes time and space
+// quadratic in its depth, because of the indentation, so it gets a
+// shallower one.
+static const long DEEP_NODES = 1000000;
+static const long DEEP_PRINT_NODES = 5000;
+
+static position_information pos(1, 1);
+
+
+/* One node visited by a walk, and the results it was given for its
+   operands. */
+struct visit {
+    ast_expression *node;
+    sym_index left;
+    sym_index right;
+
+    bool operator==(const visit &v) const
+    {
+        return node == v.node && left == v.left && right == v.right;
+    }
+};
+
+
+/* Records the nodes in the order binary_walk visits them. Each node's
+   result is its number in that order. */
+class recording_walk : public binary_walk
+{
+public:
+    vector<visit> visits;
+
+protected:
+    virtual sym_index leaf(ast_expression *node)
+    {
+        visits.push_back({ node, NULL_SYM, NULL_SYM });
+        return visits.size() - 1;
+    }
+
+    virtual sym_index operation(ast_binaryoperation *node,
+                                sym_index left,
+                                sym_index right)
+    {
+        visits.push_back({ node, left, right });
+        return visits.size() - 1;
+    }
+
+    virtual sym_index relation(ast_binaryrelation *node,
+                               sym_index left,
+                               sym_index right)
+    {
+        visits.push_back({ node, left, right });
+        return visits.size() - 1;
+    }
+};
+
+
+/* The same as recording_walk, recursively. It goes by the classes of the
+   nodes rather than their tags, which binary_walk goes by, so that a node
+   with the wrong tag shows up. */
+static sym_index record(ast_expression *node, vector<visit> &visits)
+{
+    ast_expression *left = NULL;
+    ast_expression *right = NULL;
+    if (ast_binaryoperation *op = dynamic_cast<ast_binaryoperation *>(node)) {
+        left = op->left;
+        right = op->right;
+    } else if (ast_binaryrelation *rel =
+                   dynamic_cast<ast_binaryrelation *>(node)) {
+        left = rel->left;
+        right = rel->right;
+    }
+
+    if (left == NULL) {
+        visits.push_back({ node, NULL_SYM, NULL_SYM });
+    } else {
+        sym_index l = record(left, visits);
+        sym_index r = record(right, visits);
+        visits.push_back({ node, l, r });
+    }
+    return visits.size() - 1;
+}
+
+
+/* A random expression at most depth operations deep, using every kind of
+   binary operation and relation. Some of the leaves are unary minuses, so
+   that the walk has leaves that aren't integers too. */
+static ast_expression *random_expression(int depth)
+{
+    if (depth == 0 || rand() % 5 == 0) {
+        ast_expression *value = new ast_integer(pos, rand() % 100);
+        if (rand() % 4 == 0) {
+            return new ast_uminus(pos, value);
+        }
+        return value;
+    }
+
+    ast_expression *l = random_expression(depth - 1);
+    ast_expression *r = random_expression(depth - 1);
+    switch (rand() % 12) {
+    case 0:
+        return new ast_add(pos, l, r);
+    case 1:
+        return new ast_sub(pos, l, r);
+    case 2:
+        return new ast_or(pos, l, r);
+    case 3:
+        return new ast_and(pos, l, r);
+    case 4:
+        return new ast_mult(pos, l, r);
+    case 5:
+        return new ast_divide(pos, l, r);
+    case 6:
+        return new ast_idiv(pos, l, r);
+    case 7:
+        return new ast_mod(pos, l, r);
+    case 8:
+        return new ast_equal(pos, l, r);
+    case 9:
+        return new ast_notequal(pos, l, r);
+    case 10:
+        return new ast_lessthan(pos, l, r);
+    default:
+        return new ast_greaterthan(pos, l, r);
+    }
+}
+
+
+/* An expression nodes long, like 1 + 1 + ... + 1 if left is set, or
+   1 - (1 - (... - 1)) otherwise. */
+static ast_expression *deep_expression(long nodes, bool left)
+{
+    ast_expression *e = new ast_integer(pos, 1);
+    for (long i = 1; i < nodes; i++) {
+        if (left) {
+            e = new ast_add(pos, e, new ast_integer(pos, 1));
+        } else {
+            e = new ast_sub(pos, new ast_integer(pos, 1), e);
+        }
+    }
+    return e;
+}
+
+
+/* Counts what is written to it, and throws it away. */
+class counting_buffer : public streambuf
+{
+public:
+    long count = 0;
+
+protected:
+    virtual int overflow(int c)
+    {
+        count++;
+        return c;
+    }
+
+    virtual streamsize xsputn(const char *, streamsize n)
+    {
+        count += n;
+        return n;
+    }
+};
+
+
+/* Compares binary_walk with a recursive walk over random expressions. */
+static bool test_random()
+{
+    srand(1);
+    for (int i = 0; i < 2000; i++) {
+        ast_expression *e = random_expression(8);
+        recording_walk walk;
+        vector<visit> expected;
+        sym_index result = walk.run(e);
+        sym_index expected_result = record(e, expected);
+        if (walk.visits != expected || result != expected_result) {
+            cerr << "Random expression " << i << " walked wrongly" << endl;
+            return false;
+        }
+    }
+    cout << "Random expressions: ok" << endl;
+    return true;
+}
+
+
+/* Walks, type checks, optimizes, generates quads for and prints deep
+   expressions leaning both ways. */
+static bool test_deep()
+{
+    for (int left = 1; left >= 0; left--) {
+        ast_expression *e = deep_expression(DEEP_NODES, left);
+        recording_walk walk;
+        walk.run(e);
+        if ((long) walk.visits.size() != DEEP_NODES * 2 - 1) {
+            cerr << "Deep expression walked wrongly" << endl;
+            return false;
+        }
+
+        quad_list q(0);
+        e->type_check();
+        e->optimize();
+        e->generate_quads(q);
+
+        counting_buffer buffer;
+        ostream o(&buffer);
+        o << deep_expression(DEEP_PRINT_NODES, left);
+
+        cout << "Deep " << (left ? "left" : "right") << " expression: ok ("
+             << DEEP_NODES << " nodes, printed " << DEEP_PRINT_NODES
+             << " nodes in " << buffer.count << " bytes)" << endl;
+    }
+    return true;
+}
+
+
+/* Runs the deep tests. The globals are thread local, so they are set up
+   on this thread. */
+static void *run_deep(void *ok)
+{
+    sym_tab = new symbol_table(NULL);
+    *(bool *) ok = test_deep();
+    delete sym_tab;
+    return NULL;
+}
+
+
+int main(int, char **)
+{
+    sym_tab = new symbol_table(NULL);
+    if (!test_random()) {
+        return 1;
+    }
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    bool ok = false;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SMALL_STACK);
+    if (pthread_create(&thread, &attr, run_deep, &ok) != 0) {
+        cerr << "Could not start a thread" << endl;
+        return 1;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1 @@
+../remaining/arena.cc
\ No newline at end of file
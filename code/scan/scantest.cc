@@ -1,7 +1,11 @@
 #include <iostream>
 #include <iomanip>
+#include <chrono>
+#include <string>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "symtab.hh"
 #include "scanner.hh"
 
@@ -18,6 +22,19 @@ typedef struct {
 YYSTYPE yylval;
 YYLTYPE yylloc;
 
+/* The scanner is reentrant, and returns the token values through the
+   pointers it is given to yylval and yylloc. */
+typedef void *yyscan_t;
+static yyscan_t scanner;
+
+extern yyscan_t create_scanner();
+extern void destroy_scanner(yyscan_t);
+extern bool scan_mapped_file(yyscan_t, const char *);
+extern void scan_stream(yyscan_t, FILE *);
+extern int yylex(YYSTYPE *, YYLTYPE *, yyscan_t);
+extern char *yyget_text(yyscan_t);
+extern void yyset_lineno(int, yyscan_t);
+
 
 /* List of all tokens. */
 token_name tokens[] = {
@@ -81,7 +98,6 @@ ostream &print_token(ostream &o, int token)
     int i;
     double re; // variable used to printing yylval.rval
     long in; // variable used to printing yylval.ival
-    extern char *yytext;
     extern YYLTYPE yylloc;
     extern YYSTYPE yylval; /* #change extern YYSTYPE yylval;*/
     for (i = 0; i < nr_tokens; i++) {
@@ -90,28 +106,28 @@ ostream &print_token(ostream &o, int token)
         if (token == tokens[i].token) {
             if (i == 40) {
                 re = yylval.rval;
-                o << tokens[i].name << " \'" << yytext << "\' "
+                o << tokens[i].name << " \'" << yyget_text(scanner) << "\' "
                   << "(" << yylloc.first_line << ", " << yylloc.first_column
                   << ")" << " <yylval.rval = " << re << ">";
                 return o;
             } else if (i == 37) {
                 in = yylval.ival;
-                o << tokens[i].name << " \'" << yytext << "\' "
+                o << tokens[i].name << " \'" << yyget_text(scanner) << "\' "
                   << "(" << yylloc.first_line << ", " << yylloc.first_column
                   << ")" << " <yylval.ival = " << in << ">";
                 return o;
             } else if (i == 43) {
-                o << tokens[i].name << " \'" << yytext << "\' "
+                o << tokens[i].name << " \'" << yyget_text(scanner) << "\' "
                   << "(" << yylloc.first_line << ", " << yylloc.first_column
                   << ")" << " <yylval.str = " << sym_tab->capitalize(sym_tab->pool_lookup(yylval.str)) << ">";
                 return o;
             } else if (i == 31) {
-                o << tokens[i].name << " \'" << yytext << "\' "
+                o << tokens[i].name << " \'" << yyget_text(scanner) << "\' "
                   << "(" << yylloc.first_line << ", " << yylloc.first_column
                   << ")" << " <yylval.pool_p = " << sym_tab->pool_lookup(yylval.pool_p) << ">";
                 return o;
             } else {
-                o << tokens[i].name << " \'" << yytext << "\' "
+                o << tokens[i].name << " \'" << yyget_text(scanner) << "\' "
                   << "(" << yylloc.first_line << ", " << yylloc.first_column
                   << ")";
                 return o;
@@ -151,38 +167,304 @@ const Omanip_int Token(int t)
 /* Magic part ends here. */
 
 
+/*** Benchmark mode ***/
+
+/* The buffer functions of the generated scanner. */
+struct yy_buffer_state;
+typedef yy_buffer_state *YY_BUFFER_STATE;
+extern YY_BUFFER_STATE yy_scan_buffer(char *, size_t, yyscan_t);
+extern void yy_delete_buffer(YY_BUFFER_STATE, yyscan_t);
+
+
+/* A small deterministic random number generator, so that a synthetic
+   corpus is the same from run to run. */
+static unsigned int random_state = 1;
+
+static unsigned int next_random(unsigned int limit)
+{
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 8) % limit;
+}
+
+
+/* Appends a random word of lower and upper case letters and digits, which
+   starts with a letter. */
+static void random_word(string &s, int length)
+{
+    const char letters[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    s += letters[next_random(52)];
+    for (int i = 1; i < length; i++) {
+        s += letters[next_random(sizeof(letters) - 1)];
+    }
+}
+
+
+/* Appends an identifier from a vocabulary of a few thousand, so that the
+   pool sees both new and repeated spellings, like in real programs. */
+static void random_identifier(string &s)
+{
+    unsigned int word = next_random(4096);
+    unsigned int saved_state = random_state;
+    random_state = word + 1;
+    random_word(s, 1 + next_random(12));
+    random_state = saved_state;
+}
+
+
+/* Appends comment text: words of letters, none of which ends a comment. */
+static void random_text(string &s, int length)
+{
+    size_t end = s.size() + length;
+    while (s.size() < end) {
+        random_word(s, 1 + next_random(10));
+        s += ' ';
+    }
+}
+
+
+/* Appends an integer, real or string constant. */
+static void random_literal(string &s)
+{
+    char number[32];
+
+    switch (next_random(4)) {
+    case 0:
+        snprintf(number, sizeof(number), "%u", next_random(1000000000));
+        s += number;
+        break;
+    case 1:
+        snprintf(number, sizeof(number), "%u.%u", next_random(100000),
+                 next_random(1000000));
+        s += number;
+        break;
+    case 2:
+        snprintf(number, sizeof(number), "%u.%ue%s%u", next_random(10),
+                 next_random(100000000), next_random(2) ? "-" : "+",
+                 next_random(300));
+        s += number;
+        break;
+    default:
+        s += '\'';
+        random_text(s, next_random(30));
+        if (next_random(4) == 0) {
+            s += "''";
+            random_text(s, next_random(10));
+        }
+        s += '\'';
+        break;
+    }
+}
+
+
+/* Generates a corpus of about size bytes, consisting of statements that
+   are mostly identifiers, mostly comments or mostly constants. */
+static string generate_corpus(const string &kind, size_t size)
+{
+    string s;
+
+    random_state = 1;
+    while (s.size() < size) {
+        if (kind == "ident") {
+            random_identifier(s);
+            s += " := ";
+            random_identifier(s);
+            for (int n = next_random(5); n > 0; n--) {
+                s += next_random(2) ? " + " : " * ";
+                random_identifier(s);
+                if (next_random(3) == 0) {
+                    s += '[';
+                    random_identifier(s);
+                    s += ']';
+                }
+            }
+            s += next_random(8) == 0 ? ";\nend;\nbegin\n" : ";\n";
+        } else if (kind == "comment") {
+            switch (next_random(3)) {
+            case 0:
+                s += "{ ";
+                random_text(s, 40 + next_random(200));
+                s += "}\n";
+                break;
+            case 1:
+                s += "/* ";
+                random_text(s, 40 + next_random(200));
+                s += "*/\n";
+                break;
+            default:
+                s += "// ";
+                random_text(s, 20 + next_random(60));
+                s += '\n';
+                break;
+            }
+            s += "x := 1;\n";
+        } else {
+            random_identifier(s);
+            s += " := ";
+            random_literal(s);
+            for (int n = next_random(4); n > 0; n--) {
+                s += " + ";
+                random_literal(s);
+            }
+            s += ";\n";
+        }
+    }
+    return s;
+}
+
+
+/* Reads a whole file into a string. */
+static string read_file(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        perror(filename);
+        exit(1);
+    }
+
+    string s;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        s.append(chunk, n);
+    }
+    fclose(f);
+    return s;
+}
+
+
+/* Scans text passes times, straight from memory, and prints the token and
+   byte throughput, along with the number of bytes the scanner installed in
+   the string pool. */
+static void run_benchmark(const string &name, const string &text, int passes)
+{
+    // flex wants two null bytes at the end, and writes into the buffer.
+    char *buffer = new char[text.size() + 2];
+    long pool_before = sym_tab->pool_used();
+    long tokens = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++) {
+        memcpy(buffer, text.data(), text.size());
+        buffer[text.size()] = buffer[text.size() + 1] = '\0';
+        YY_BUFFER_STATE state =
+            yy_scan_buffer(buffer, text.size() + 2, scanner);
+        yyset_lineno(1, scanner);
+        while (yylex(&yylval, &yylloc, scanner) != 0) {
+            tokens++;
+        }
+        yy_delete_buffer(state, scanner);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    delete[] buffer;
+
+    double megabytes = (double) text.size() * passes / (1024 * 1024);
+    cout << left << setw(10) << name << right << fixed << setprecision(2)
+         << setw(8) << (double) text.size() / (1024 * 1024) << " MB x "
+         << passes << ": "
+         << setw(10) << tokens / passes << " tokens/pass "
+         << setw(8) << tokens / elapsed.count() / 1e6 << " Mtokens/s "
+         << setw(8) << megabytes / elapsed.count() << " MB/s "
+         << setw(10) << sym_tab->pool_used() - pool_before << " pool bytes\n"
+         << flush;
+}
+
+
+/* Benchmark mode: scantest -b [-n passes] [-s megabytes] [-g kind] [file]
+   scans the file, or a synthetic corpus of the given kind (ident, comment
+   or literal), the given number of times. Without either, all three kinds
+   of corpus are compared. */
+static void benchmark(int argc, char **argv)
+{
+    int passes = 10;
+    double megabytes = 4;
+    string kind;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:s:g:")) != EOF) {
+        switch (option) {
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        case 's':
+            megabytes = atof(optarg);
+            break;
+        case 'g':
+            kind = optarg;
+            if (kind != "ident" && kind != "comment" && kind != "literal") {
+                cerr << "Unknown corpus kind " << kind << '\n';
+                exit(1);
+            }
+            break;
+        default:
+            exit(1);
+        }
+    }
+    if (passes < 1) {
+        passes = 1;
+    }
+
+    size_t size = megabytes * 1024 * 1024;
+    if (optind < argc) {
+        run_benchmark(argv[optind], read_file(argv[optind]), passes);
+    } else if (!kind.empty()) {
+        run_benchmark(kind, generate_corpus(kind, size), passes);
+    } else {
+        run_benchmark("ident", generate_corpus("ident", size), passes);
+        run_benchmark("comment", generate_corpus("comment", size), passes);
+        run_benchmark("literal", generate_corpus("literal", size), passes);
+    }
+}
+
+
 /* Interactive scanner. We just parse whatever is typed in, and the token
    type and corresponding yytext is printed. */
 int main(int argc, char **argv)
 {
     int     token;
-    extern  FILE *yyin;
-    extern  int yylex();
+    FILE    *file = NULL;
+
+    scanner = create_scanner();
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        benchmark(argc - 1, argv + 1);
+        exit(0);
+    }
 
     /* Open the input file, if any. */
     switch (argc) {
     case 1:
-        yyin = stdin;
+        scan_stream(scanner, stdin);
         break;
     case 2:
-        yyin = fopen(argv[1], "r");
-        if (yyin == NULL) {
+        if (scan_mapped_file(scanner, argv[1])) {
+            break;
+        }
+        file = fopen(argv[1], "r");
+        if (file == NULL) {
             perror(argv[1]);
             exit(1);
         }
+        scan_stream(scanner, file);
         break;
     default:
-        cerr << "Usage: " << argv[0] << " [ filename ]\n";
+        cerr << "Usage: " << argv[0] << " [ filename ]\n"
+             << "       " << argv[0] << " -b [ -n passes ] [ -s megabytes ] "
+             << "[ -g ident|comment|literal ] [ filename ]\n";
         exit(1);
     }
 
     /* Loop for as long as there are tokens */
 
-    while ((token = yylex()) != 0) {
+    while ((token = yylex(&yylval, &yylloc, scanner)) != 0) {
         cout << "Scanned " << Token(token) << '\n' << flush;
     }
 
     cout << "End of file\n";
+    destroy_scanner(scanner);
+    if (file != NULL) {
+        fclose(file);
+    }
     exit(0);
 }
 
@@ -0,0 +1 @@
+../remaining/arena.hh
\ No newline at end of file
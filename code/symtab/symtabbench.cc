@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "scanner.hh"
+#include "symtab.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+// Measures how the symbol table copes with large programs. For each size, a
+// fresh symbol table gets one procedure with that many local variables,
+// arrays and constants, all of which are then looked up once, and have
+// their fields read once, before the scope is closed again. Run it with
+// 'make bench'.
+
+// What the fields read add up to.
+static volatile long fields_sum;
+
+// Seconds elapsed since start.
+static double seconds_since(steady_clock::time_point start)
+{
+    return duration_cast<duration<double> >(steady_clock::now() - start).count();
+}
+
+
+static void bench(long nr_symbols)
+{
+    position_information *pos = new position_information();
+    char name[32];
+
+    // The constructor installs the predefined symbols into the new table.
+    // sym_tab must point to the table in use, since the symbol classes
+    // refer to it. The previous table, and all its symbols, are freed.
+    delete sym_tab;
+    sym_tab = new symbol_table();
+
+    sym_tab->enter_procedure(pos, sym_tab->pool_install((char *) "BENCH"));
+    sym_tab->open_scope();
+
+    // The kinds are mixed, so that reading the fields below can't always
+    // guess the kind of the next symbol.
+    steady_clock::time_point start = steady_clock::now();
+    for (long i = 0; i < nr_symbols; i++) {
+        snprintf(name, sizeof(name), "V%ld", i);
+        pool_index id = sym_tab->pool_install(name);
+        switch (i * 7919 % 3) {
+        case 0:
+            sym_tab->enter_variable(pos, id, integer_type);
+            break;
+        case 1:
+            sym_tab->enter_array(pos, id, integer_type, 10);
+            break;
+        default:
+            sym_tab->enter_constant(pos, id, integer_type, i);
+            break;
+        }
+    }
+    double install_time = seconds_since(start);
+
+    // Installing an existing name returns its interned index, so this is
+    // the lookup path the parser takes for every identifier reference.
+    start = steady_clock::now();
+    long found = 0;
+    vector<sym_index> symbols;
+    for (long i = 0; i < nr_symbols; i++) {
+        snprintf(name, sizeof(name), "V%ld", i);
+        sym_index sym = sym_tab->lookup_symbol(sym_tab->pool_install(name));
+        if (sym != NULL_SYM) {
+            symbols.push_back(sym);
+            found++;
+        }
+    }
+    double lookup_time = seconds_since(start);
+
+    // Read what the code generator reads of each symbol: the hot fields,
+    // and the value of a constant from the symbol object. The symbols are
+    // visited in a scattered order, as the references in a program would
+    // visit them.
+    start = steady_clock::now();
+    long sum = 0;
+    for (long n = 0; n < found; n++) {
+        sym_index sym_p = symbols[n * 7919 % found];
+        symbol_hot *hot = sym_tab->get_symbol_hot(sym_p);
+        switch (hot->tag) {
+        case SYM_VAR:
+        case SYM_ARRAY:
+            sum += hot->offset;
+            break;
+        case SYM_CONST:
+            sum += sym_tab->get_symbol(sym_p)->get_constant_symbol()->
+                const_value.ival;
+            break;
+        default:
+            break;
+        }
+        sum += hot->level + hot->type;
+    }
+    double fields_time = seconds_since(start);
+    // Keeps the reads above from being optimized away.
+    fields_sum = sum;
+
+    start = steady_clock::now();
+    sym_tab->close_scope();
+    double close_time = seconds_since(start);
+
+    if (found != nr_symbols) {
+        cerr << "Only found " << found << " of " << nr_symbols
+             << " symbols!" << endl;
+        exit(1);
+    }
+
+    cout << setw(9) << nr_symbols
+         << setw(12) << fixed << setprecision(3) << install_time * 1000
+         << setw(12) << (long) (nr_symbols / install_time)
+         << setw(12) << lookup_time * 1000
+         << setw(12) << (long) (nr_symbols / lookup_time)
+         << setw(12) << fields_time * 1000
+         << setw(12) << close_time * 1000 << endl;
+}
+
+
+int main(int argc, char **argv)
+{
+    cout << "  Symbols  Install ms   Install/s   Lookup ms    Lookup/s"
+         << "   Fields ms    Close ms\n";
+    cout << "---------------------------------------------------------"
+         << "------------------------\n";
+
+    for (long n = 10000; n <= 1000000; n *= 10) {
+        bench(n);
+    }
+
+    return 0;
+}
@@ -9,10 +9,6 @@ using namespace std;
 // Set the #defines to 1 if you want the code which produces the
 // the corresponding trace file to be generated, and 0 otherwise.
 
-YYSTYPE yylval;
-YYLTYPE yylloc;
-
-
 int main(int argc, char **argv) {
     // This is just a dummy position for the preinstalled functions.
     position_information *pos = new position_information();